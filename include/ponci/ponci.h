@@ -18,8 +18,84 @@
 #ifndef ponci_h
 #define ponci_h
 
+#include <inttypes.h>
 #include <sys/types.h>
 
+/* Maximum number of CPUs reported in cgroup_cpu_stat::usage_percpu. */
+#define PONCI_MAX_CPUS 256
+
+/* Maximum number of NUMA nodes reported in cgroup_memory_stat. */
+#define PONCI_MAX_NUMA_NODES 64
+
+/**
+ * Memory statistics of a cgroup. All values are in bytes, except for the fault counters.
+ * On cgroup v1 the values are read from memory.usage_in_bytes, memory.max_usage_in_bytes,
+ * memory.stat and memory.numa_stat. On cgroup v2 they are read from memory.current,
+ * memory.peak (0 if not supported by the kernel), memory.stat and memory.numa_stat.
+ * The names of the memory.stat fields follow cgroup v1, e.g. cache is called file on v2.
+ * numa_total / numa_file / numa_anon show on which nodes the memory is actually located,
+ * on cgroup v2 numa_total is the sum of numa_file and numa_anon.
+ */
+struct cgroup_memory_stat {
+	uint64_t usage;
+	uint64_t max_usage;
+
+	uint64_t cache;
+	uint64_t rss;
+	uint64_t rss_huge;
+	uint64_t shmem;
+	uint64_t mapped_file;
+	uint64_t dirty;
+	uint64_t writeback;
+	uint64_t inactive_anon;
+	uint64_t active_anon;
+	uint64_t inactive_file;
+	uint64_t active_file;
+	uint64_t unevictable;
+	uint64_t pgfault;
+	uint64_t pgmajfault;
+
+	size_t num_nodes;
+	uint64_t numa_total[PONCI_MAX_NUMA_NODES];
+	uint64_t numa_file[PONCI_MAX_NUMA_NODES];
+	uint64_t numa_anon[PONCI_MAX_NUMA_NODES];
+};
+
+/**
+ * CPU accounting of a cgroup. All times are in nanoseconds.
+ * On cgroup v1 the values are read from cpuacct.usage, cpuacct.usage_percpu,
+ * cpuacct.stat and cpu.stat (if the cpu controller is available). On cgroup v2
+ * they are read from cpu.stat, usage_percpu is not available (num_cpus is 0).
+ * usage_percpu holds the first num_cpus of the num_cpus_total CPUs reported by the
+ * kernel, i.e. it is truncated if num_cpus_total > num_cpus (more than PONCI_MAX_CPUS).
+ */
+struct cgroup_cpu_stat {
+	uint64_t timestamp; /* CLOCK_MONOTONIC when the sample was taken */
+	uint64_t usage;
+	uint64_t user;
+	uint64_t system;
+	uint64_t nr_periods;
+	uint64_t nr_throttled;
+	uint64_t throttled;
+	size_t num_cpus;
+	size_t num_cpus_total;
+	uint64_t usage_percpu[PONCI_MAX_CPUS];
+};
+
+/**
+ * CPU usage between two samples of a cgroup.
+ * usage, user and system are the average number of CPUs used, e.g. 1.5.
+ * throttled is the fraction of the elapsed time the cgroup was throttled and
+ * throttled_periods the fraction of the enforcement periods with throttling.
+ */
+struct cgroup_cpu_rate {
+	double usage;
+	double user;
+	double system;
+	double throttled;
+	double throttled_periods;
+};
+
 /**
  * Creates a new cgroup with the @p name.
  */
@@ -126,4 +202,133 @@ void cgroup_wait_thawed(const char *name);
  */
 void cgroup_kill(const char *name);
 
+/**
+ * Starts a new process directly inside the cgroup @p name, i.e. the process never
+ * runs (or allocates memory) outside of the cgroup. @p argv[0] must be the path of
+ * the executable, @p argv and @p envp must be NULL terminated.
+ * On cgroup v2 clone3(CLONE_INTO_CGROUP) is used. On cgroup v1 (or older kernels) the
+ * child adds itself to the cgroup between fork and exec.
+ * Returns a pidfd of the new process or -1 if the kernel does not support pidfds.
+ * The process id is stored in @p pid if it is not NULL.
+ */
+int cgroup_spawn(const char *name, char *const argv[], char *const envp[], pid_t *pid);
+
+/**
+ * Samples the CPU accounting of all @p size cgroups in @p names into @p stats.
+ * @p stats must have room for @p size elements.
+ */
+void cgroup_sample_cpu(const char *const *names, size_t size, struct cgroup_cpu_stat *stats);
+
+/**
+ * Stores the difference @p second - @p first in @p delta.
+ */
+void cgroup_cpu_stat_delta(const struct cgroup_cpu_stat *first, const struct cgroup_cpu_stat *second,
+						   struct cgroup_cpu_stat *delta);
+
+/**
+ * Computes the CPU usage between the samples @p first and @p second of the same cgroup.
+ */
+void cgroup_cpu_stat_rate(const struct cgroup_cpu_stat *first, const struct cgroup_cpu_stat *second,
+						  struct cgroup_cpu_rate *rate);
+
+/**
+ * Samples the memory statistics of all @p size cgroups in @p names into @p stats.
+ * @p stats must have room for @p size elements.
+ */
+void cgroup_sample_memory(const char *const *names, size_t size, struct cgroup_memory_stat *stats);
+
+/**
+ * Returns the current memory usage of cgroup @p name in bytes.
+ */
+uint64_t cgroup_get_memory_usage(const char *name);
+
+/**
+ * No-throw variants of the functions above, safe to be called from C. They return 0 on
+ * success or an errno code, e.g. ESRCH if the task passed to cgroup_add_task_r already
+ * exited, ENODEV if no cgroup hierarchy is mounted, EINVAL for an invalid argument (e.g.
+ * an empty argv of cgroup_spawn_r), ENOMEM if an allocation failed and EIO for any other
+ * error. They build the path names on the heap, so they are not async-signal-safe.
+ * The functions without the _r suffix throw a std::system_error (a std::runtime_error)
+ * with the same code.
+ * Functions that only read or sample (cgroup_get_*, cgroup_sample_*, cgroup_wait_*, ...)
+ * have no _r variant and may throw. cgroup_spawn_r stores the result of cgroup_spawn in
+ * @p pidfd if it is not NULL.
+ */
+int cgroup_create_r(const char *name);
+int cgroup_delete_r(const char *name);
+int cgroup_add_me_r(const char *name);
+int cgroup_add_task_r(const char *name, pid_t tid);
+int cgroup_set_cpus_r(const char *name, const size_t *cpus, size_t size);
+int cgroup_set_mems_r(const char *name, const size_t *mems, size_t size);
+int cgroup_set_memory_migrate_r(const char *name, size_t flag);
+int cgroup_set_cpus_exclusive_r(const char *name, size_t flag);
+int cgroup_set_mem_hardwall_r(const char *name, size_t flag);
+int cgroup_set_scheduling_domain_r(const char *name, int flag);
+int cgroup_freeze_r(const char *name);
+int cgroup_thaw_r(const char *name);
+int cgroup_kill_r(const char *name);
+int cgroup_spawn_r(const char *name, char *const argv[], char *const envp[], pid_t *pid, int *pidfd);
+
+/**
+ * Thread safety: all functions of libponci and libponri can be called concurrently by any
+ * number of threads without external locking. The mount points and subsystems of a context
+ * are discovered once and read without locks afterwards, the resctrl info snapshot is
+ * replaced atomically. The file writes themselves are not ordered, e.g. concurrent
+ * cgroup_set_cpus on the same cgroup leave one of the values.
+ */
+
+/**
+ * A context holds the cgroup and resctrl roots all functions of libponci / libponri work on,
+ * together with everything discovered from them (subsystems, the resctrl info snapshot).
+ * Every thread uses the default context until it selects another one with
+ * ponci_context_use. The default context uses PONCI_PATH and PONRI_PATH if set.
+ */
+struct ponci_context;
+
+/**
+ * Creates a context. @p cgroup_root either contains one directory per cgroup v1
+ * subsystem (cpuset, freezer, ...) or is a cgroup v2 hierarchy and must end with '/'.
+ * NULL roots are discovered from /proc/self/mountinfo.
+ */
+struct ponci_context *ponci_context_create(const char *cgroup_root, const char *resctrl_root);
+
+/**
+ * Destroys a context created by ponci_context_create. No thread may use it anymore.
+ */
+void ponci_context_destroy(struct ponci_context *ctx);
+
+/**
+ * Selects the context used by the calling thread, NULL selects the default context.
+ * Returns the previously used context.
+ */
+struct ponci_context *ponci_context_use(struct ponci_context *ctx);
+
+/**
+ * Returns the context used by the calling thread.
+ */
+struct ponci_context *ponci_context_current();
+
+/**
+ * Enables (@p enable != 0) or disables the write cache of @p ctx, it is disabled by default.
+ * With the cache enabled, cgroup_set_cpus, cgroup_set_mems and the schemata functions of
+ * libponri skip values that were already written through @p ctx, e.g. to avoid the page
+ * migration triggered by every write of cpuset.mems with memory_migrate enabled.
+ * Changes made outside of @p ctx are only noticed by ponci_context_invalidate or
+ * ponci_context_revalidate.
+ * As for ponci_context_use, NULL selects the default context in this and the next two
+ * functions.
+ */
+void ponci_context_set_write_cache(struct ponci_context *ctx, int enable);
+
+/**
+ * Drops all values cached by @p ctx, i.e. the next write of every attribute reaches the kernel.
+ */
+void ponci_context_invalidate(struct ponci_context *ctx);
+
+/**
+ * Re-reads all attributes cached by @p ctx and drops the values that were changed outside
+ * of @p ctx. Returns the number of dropped values.
+ */
+size_t ponci_context_revalidate(struct ponci_context *ctx);
+
 #endif /* end of include guard: ponci_h */
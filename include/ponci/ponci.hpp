@@ -16,8 +16,13 @@
 #ifndef ponci_hpp
 #define ponci_hpp
 
+#include <atomic>
 #include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #ifdef __cplusplus
@@ -81,6 +86,156 @@ inline void cgroup_wait_frozen(const std::string &name) { cgroup_wait_frozen(nam
 
 inline void cgroup_kill(const std::string &name) { cgroup_kill(name.c_str()); }
 
+inline int cgroup_spawn(const std::string &name, char *const argv[], char *const envp[], pid_t *pid = nullptr) {
+	return cgroup_spawn(name.c_str(), argv, envp, pid);
+}
+
+std::vector<cgroup_cpu_stat> cgroup_sample_cpu(const std::vector<std::string> &names);
+
+inline cgroup_cpu_rate cgroup_cpu_stat_rate(const cgroup_cpu_stat &first, const cgroup_cpu_stat &second) {
+	cgroup_cpu_rate rate;
+	cgroup_cpu_stat_rate(&first, &second, &rate);
+	return rate;
+}
+
+std::vector<cgroup_memory_stat> cgroup_sample_memory(const std::vector<std::string> &names);
+
+inline uint64_t cgroup_get_memory_usage(const std::string &name) { return cgroup_get_memory_usage(name.c_str()); }
+
+/**
+ * Returns the CPUs / memory nodes currently assigned to the cgroup @p name.
+ */
+std::vector<size_t> cgroup_get_cpus(const std::string &name);
+std::vector<size_t> cgroup_get_mems(const std::string &name);
+
+/**
+ * Returns the tasks currently in the cgroup @p name.
+ */
+std::vector<pid_t> cgroup_get_tasks(const std::string &name);
+
+/**
+ * Uses the context @p ctx in the calling thread for the lifetime of the guard.
+ */
+class ponci_context_guard {
+  public:
+	explicit ponci_context_guard(ponci_context *ctx) : previous(ponci_context_use(ctx)) {}
+	~ponci_context_guard() { ponci_context_use(previous); }
+
+	ponci_context_guard(const ponci_context_guard &) = delete;
+	ponci_context_guard &operator=(const ponci_context_guard &) = delete;
+
+  private:
+	ponci_context *previous;
+};
+
+/**
+ * Creates one child cgroup of @p parent per worker thread. Every child gets a single CPU
+ * of @p parent (round-robin if there are more workers than CPUs) and the memory node of
+ * that CPU, or all memory nodes of @p parent if @p parent does not have that node.
+ * Worker threads call pin() or the function returned by pin_function() on startup to
+ * enter their cgroup, both use the context of the thread creating the object.
+ * The destructor moves all remaining tasks back to @p parent and deletes the children.
+ * The constructor throws if @p workers is 0 or @p parent has no CPUs or memory nodes,
+ * and deletes the children it created if it fails later on.
+ */
+class worker_cgroups {
+  public:
+	worker_cgroups(const std::string &parent, size_t workers);
+	~worker_cgroups();
+
+	worker_cgroups(const worker_cgroups &) = delete;
+	worker_cgroups &operator=(const worker_cgroups &) = delete;
+
+	/**
+	 * Adds the calling thread to the cgroup of @p worker.
+	 */
+	void pin(size_t worker) const {
+		ponci_context_guard guard(context);
+		cgroup_add_me(names[worker]);
+	}
+
+	/**
+	 * Returns a function adding the calling thread to the cgroup of the next worker, i.e.
+	 * the n-th call of any copy of the function pins to worker n % size().
+	 */
+	std::function<void()> pin_function() const;
+
+	const std::string &name(size_t worker) const { return names[worker]; }
+	size_t cpu(size_t worker) const { return cpus[worker]; }
+	size_t size() const { return names.size(); }
+
+  private:
+	ponci_context *context;
+	std::string parent;
+	std::vector<std::string> names;
+	std::vector<size_t> cpus;
+	std::shared_ptr<std::atomic<size_t>> next;
+};
+
+/**
+ * Values a cgroup_pool resets a cgroup to when leasing it. Empty CPUs / memory nodes are
+ * taken from the parent of the pool. With @p frozen leased cgroups are frozen.
+ */
+struct cgroup_template {
+	cgroup_template(std::vector<size_t> _cpus = {}, std::vector<size_t> _mems = {}, bool _frozen = false)
+		: cpus(std::move(_cpus)), mems(std::move(_mems)), frozen(_frozen) {}
+
+	std::vector<size_t> cpus;
+	std::vector<size_t> mems;
+	bool frozen;
+};
+
+/**
+ * Recycles children of @p parent instead of creating and deleting a cgroup for every
+ * short-lived job, as mkdir / rmdir of cgroups is slow. lease() returns a free cgroup reset
+ * to the template, release() thaws it, moves its remaining tasks to @p parent and returns
+ * it to the pool. Only attributes that differ from the template are written on lease.
+ * All member functions are thread-safe and use the context of the thread creating the pool.
+ */
+class cgroup_pool {
+  public:
+	/**
+	 * Creates @p size cgroups named @p parent/@p prefix0, @p parent/@p prefix1, ...
+	 * If the constructor throws, the cgroups it created are deleted.
+	 */
+	cgroup_pool(const std::string &parent, size_t size, const cgroup_template &templ = {},
+				const std::string &prefix = "ponci_pool");
+
+	/**
+	 * Moves all remaining tasks to the parent and deletes the cgroups.
+	 */
+	~cgroup_pool();
+
+	cgroup_pool(const cgroup_pool &) = delete;
+	cgroup_pool &operator=(const cgroup_pool &) = delete;
+
+	/**
+	 * Returns the name of a free cgroup configured as the template. Throws if all cgroups
+	 * are leased.
+	 */
+	std::string lease();
+
+	/**
+	 * Releases a cgroup returned by lease.
+	 */
+	void release(const std::string &name);
+
+	size_t size() const { return groups.size(); }
+	size_t leased() const;
+
+  private:
+	struct entry {
+		std::string name;
+		bool leased;
+	};
+
+	ponci_context *context;
+	std::string parent;
+	cgroup_template templ;
+	std::vector<entry> groups;
+	mutable std::mutex mutex;
+};
+
 #endif /* end of the c++ only functions */
 
 #endif /* end of include guard: ponci_hpp */
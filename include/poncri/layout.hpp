@@ -0,0 +1,100 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * Declarative description of cgroups and ressource groups, which is applied by only
+ * writing the differences to the live state. A layout file contains one section per group,
+ * attributes that are not given are never touched:
+ *
+ *   # comment
+ *   [cgroup app]
+ *   cpus = 0-7
+ *   mems = 0
+ *   cpu_exclusive = 1
+ *
+ *   [cgroup app/web]
+ *   cpus = 0-3
+ *   mems = 0
+ *   mem_hardwall = 0
+ *   memory_migrate = 1
+ *   freezer = THAWED
+ *
+ *   [resgroup web]
+ *   L3 = 0=ff;1=ff
+ *   MB = 0=50;1=50
+ *
+ * C++ only.
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncri_layout_hpp
+#define poncri_layout_hpp
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "ponci/ponci.hpp"
+#include "ponri/ponri.hpp"
+
+/**
+ * A cgroup of a layout. Empty lists, negative flags and an empty freezer state are not managed.
+ */
+struct cgroup_layout {
+	std::string name;
+	std::vector<size_t> cpus;
+	std::vector<size_t> mems;
+	int cpu_exclusive = -1;
+	int mem_hardwall = -1;
+	int memory_migrate = -1;
+	std::string freezer;
+};
+
+/**
+ * A ressource group of a layout, only the given schemata entries are managed.
+ */
+struct resgroup_layout {
+	std::string name;
+	resgroup_schemata schemata;
+};
+
+struct layout {
+	std::vector<cgroup_layout> cgroups;
+	std::vector<resgroup_layout> resgroups;
+};
+
+/**
+ * Parses a layout in the format described above, errors are reported with their line number.
+ */
+layout layout_parse(std::istream &in);
+layout layout_read(const std::string &filename);
+
+/**
+ * Returns the live state of the cgroup @p cgroup_root and all cgroups below it (the root
+ * cgroup itself is skipped for "") and of all ressource groups including the default group.
+ * All attributes are managed in the result.
+ */
+layout layout_capture(const std::string &cgroup_root);
+
+/**
+ * Brings the live state in line with @p l and returns the changes made, one line each, e.g.
+ * "set cgroup app/web cpus 0-3". Groups are created if missing, but never deleted.
+ * Only differing attributes are written, in an order the kernel accepts: exclusive flags
+ * are cleared bottom-up (also on groups whose cpus change and on their exclusive siblings),
+ * cpus / mems are widened top-down (creating groups on the way) and narrowed bottom-up,
+ * exclusive flags are set top-down and freezer states are changed last.
+ * With @p dry_run the changes are only computed. @p progress is called with every change
+ * before it is applied.
+ * The changes are not atomic: if one fails, the changes before it stay applied and the
+ * exception names the failed change and the number of changes applied before it.
+ */
+std::vector<std::string> ponci_apply(const layout &l, bool dry_run = false,
+									 const std::function<void(const std::string &)> &progress = nullptr);
+
+#endif /* end of include guard: poncri_layout_hpp */
@@ -0,0 +1,74 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * A partition combines a cgroup (cpuset / freezer) and a resctrl ressource group of the
+ * same name, so tasks are always isolated by both. C++ only.
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncri_partition_hpp
+#define poncri_partition_hpp
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "ponci/ponci.hpp"
+#include "ponri/ponri.hpp"
+
+/**
+ * Owns a cgroup and a ressource group named @p name. The CPUs of both are kept identical
+ * and tasks are always added to both.
+ * The destructor moves all remaining tasks to the root cgroup / default ressource group
+ * and deletes both groups. If the constructor throws, the groups it created are deleted.
+ * All member functions use the context of the thread creating the partition.
+ */
+class partition {
+  public:
+	partition(const std::string &name, const std::vector<size_t> &cpus, const std::vector<size_t> &mems);
+	~partition();
+
+	partition(const partition &) = delete;
+	partition &operator=(const partition &) = delete;
+
+	/**
+	 * Sets the CPUs of the cgroup and the ressource group.
+	 */
+	void set_cpus(const std::vector<size_t> &cpus);
+
+	/**
+	 * Sets the memory nodes of the cgroup.
+	 */
+	void set_mems(const std::vector<size_t> &mems);
+
+	/**
+	 * Updates the schemata of the ressource group, see resgroup_update_schemata.
+	 */
+	void set_schemata(const resgroup_schemata &schemata);
+
+	/**
+	 * Adds the thread @p tid / the calling thread to the cgroup and the ressource group.
+	 * If adding to the ressource group fails, the thread is moved to the parent cgroup.
+	 */
+	void add_task(pid_t tid);
+	void add_me();
+
+	const std::string &name() const { return _name; }
+	const std::vector<size_t> &cpus() const { return _cpus; }
+	const std::vector<size_t> &mems() const { return _mems; }
+
+  private:
+	ponci_context *context;
+	std::string _name;
+	std::vector<size_t> _cpus;
+	std::vector<size_t> _mems;
+};
+
+#endif /* end of include guard: poncri_partition_hpp */
@@ -0,0 +1,43 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * Snapshots of a cgroup subtree and all ressource groups including the tasks of every group,
+ * stored in a compact binary file. C++ only.
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#ifndef poncri_snapshot_hpp
+#define poncri_snapshot_hpp
+
+#include <string>
+#include <vector>
+
+#include "poncri/layout.hpp"
+
+/**
+ * Writes the live state of the cgroup @p cgroup_root and all cgroups below it and of all
+ * ressource groups (see layout_capture) plus the tasks of every group to @p filename.
+ * On cgroup v1 the tasks are saved per hierarchy (cpuset / freezer), as a task may be in
+ * different groups of each. Tasks of the default ressource group are not saved.
+ * Monitoring groups are not saved.
+ */
+void ponci_snapshot(const std::string &filename, const std::string &cgroup_root);
+
+/**
+ * Restores the snapshot in @p filename and returns the changes made, one line each.
+ * Groups and attributes are restored with ponci_apply, i.e. only differences are written.
+ * Tasks that are already in their group are skipped, the others are written through one
+ * open tasks file per group and hierarchy, each hierarchy with the tasks saved for it.
+ * Hierarchies not saved in the snapshot are not touched. Tasks that exited in the
+ * meantime are ignored.
+ * Throws if the file is not a valid snapshot.
+ */
+std::vector<std::string> ponci_restore(const std::string &filename);
+
+#endif /* end of include guard: poncri_snapshot_hpp */
@@ -21,6 +21,91 @@
 #include <inttypes.h>
 #include <sys/types.h>
 
+/**
+ * Cache resources that can be partitioned. The CODE / DATA resources are only
+ * available if resctrl is mounted with cdp (L3) or cdpl2 (L2) enabled.
+ */
+enum resctrl_resource { RESCTRL_L3, RESCTRL_L3CODE, RESCTRL_L3DATA, RESCTRL_L2, RESCTRL_L2CODE, RESCTRL_L2DATA };
+
+/* Maximum number of domains of a resource. */
+#define PONRI_MAX_DOMAINS 32
+
+/* Number of entries of enum resctrl_resource. */
+#define PONRI_NUM_CACHE_RESOURCES 6
+
+/**
+ * Information about a cache resource read from info/<resource>/ and the schemata of the
+ * default group. available is 0 if the resource is not supported / enabled.
+ * domains holds the first num_domains of the num_domains_total (sorted) domain ids, i.e.
+ * it is truncated if num_domains_total > num_domains (more than PONRI_MAX_DOMAINS).
+ */
+struct resctrl_cache_info {
+	int available;
+	uint64_t cbm_mask;
+	unsigned int min_cbm_bits;
+	unsigned int num_closids;
+	uint64_t shareable_bits;
+	size_t num_domains;
+	size_t num_domains_total;
+	unsigned int domains[PONRI_MAX_DOMAINS];
+};
+
+/**
+ * Snapshot of everything in the resctrl info directory, used by all libponri functions
+ * instead of reading the info files again. mb_domains is truncated like the domains of
+ * resctrl_cache_info.
+ */
+struct resctrl_info {
+	struct resctrl_cache_info cache[PONRI_NUM_CACHE_RESOURCES]; /* indexed by enum resctrl_resource */
+
+	int mb_available;
+	unsigned int mb_min_bandwidth;
+	unsigned int mb_bandwidth_gran;
+	unsigned int mb_num_closids;
+	int mba_mbps;
+	size_t mb_num_domains;
+	size_t mb_num_domains_total;
+	unsigned int mb_domains[PONRI_MAX_DOMAINS];
+
+	int mon_available;
+	unsigned int num_rmids;
+	int mon_llc_occupancy;
+	int mon_mbm_total_bytes;
+	int mon_mbm_local_bytes;
+};
+
+/* Value of a monitoring counter that is not supported or could not be read by the kernel. */
+#define PONRI_MON_UNAVAILABLE UINT64_MAX
+
+/**
+ * Monitoring counters of a ressource group for every L3 domain, read from
+ * mon_data/mon_L3_<domain>/. All values are in bytes.
+ * The counters of the first num_domains of the num_domains_total (sorted) domains are
+ * read, i.e. they are truncated if num_domains_total > num_domains.
+ */
+struct resgroup_mon_stat {
+	uint64_t timestamp; /* CLOCK_MONOTONIC when the sample was taken */
+	size_t num_domains;
+	size_t num_domains_total;
+	unsigned int domains[PONRI_MAX_DOMAINS];
+	uint64_t llc_occupancy[PONRI_MAX_DOMAINS];
+	uint64_t mbm_total_bytes[PONRI_MAX_DOMAINS];
+	uint64_t mbm_local_bytes[PONRI_MAX_DOMAINS];
+};
+
+/**
+ * Memory bandwidth in bytes per second between two samples and the LLC occupancy
+ * of the second sample per L3 domain. num_domains_total is taken from the second sample.
+ */
+struct resgroup_mon_rate {
+	size_t num_domains;
+	size_t num_domains_total;
+	unsigned int domains[PONRI_MAX_DOMAINS];
+	uint64_t llc_occupancy[PONRI_MAX_DOMAINS];
+	double mbm_total[PONRI_MAX_DOMAINS];
+	double mbm_local[PONRI_MAX_DOMAINS];
+};
+
 /**
  * Creates a ressource group
  */
@@ -42,28 +127,196 @@ void resgroup_add_me(const char *name);
 void resgroup_add_task(const char *name, pid_t tid);
 
 /**
- * Sets the CPU mask of a ressource group
+ * Sets the CPUs of a ressource group, written to its cpus_list file
  */
 void resgroup_set_cpus(const char *name, const size_t *cpus, size_t size);
 
 /**
- * Sets the schema for the ressource group. One schemata per NUMA domain
+ * Sets the schema for the ressource group. One schemata per L3 domain, the i-th
+ * schemata is used for the i-th domain returned by get_resource_domains.
  */
 void resgroup_set_schemata(const char *name, const size_t *schematas, size_t size);
 
 /**
- * Returns the maximum bit mask available.
+ * Sets the schema of the cache resource @p res for the ressource group. One schemata
+ * per cache domain, the i-th schemata is used for the i-th domain returned by
+ * get_resource_domains.
+ */
+void resgroup_set_resource_schemata(const char *name, enum resctrl_resource res, const size_t *schematas, size_t size);
+
+/**
+ * Sets the memory bandwidth allocation for the ressource group. One value per MB domain
+ * in the order of the domain ids.
+ * The values are percentages of the maximum bandwidth. They are raised to the minimum
+ * bandwidth and rounded up to the bandwidth granularity supported by the hardware.
+ * If resctrl is mounted with mba_MBps the values are the bandwidth limits in MBps.
+ */
+void resgroup_set_mb(const char *name, const size_t *bandwidths, size_t size);
+
+/**
+ * Sets the value of a single @p domain of @p resource (e.g. "L3", "MB") in the
+ * schemata of the ressource group. All other entries are not modified.
+ */
+void resgroup_set_schemata_entry(const char *name, const char *resource, unsigned int domain, uint64_t value);
+
+/**
+ * Returns the snapshot of the resctrl info directory. It is read on the first call and
+ * only re-read by resctrl_refresh_info. The pointer stays valid until the context
+ * (see ponci_context_create) is destroyed, i.e. forever for the default context.
+ */
+const struct resctrl_info *resctrl_get_info();
+
+/**
+ * Re-reads the resctrl info directory, e.g. after resctrl was remounted. The snapshot is
+ * only replaced if the info directory changed. A replaced snapshot is kept until the
+ * context is destroyed (see resctrl_get_info), so every change costs one snapshot of
+ * memory. Callers expecting many changes should use their own context and destroy it
+ * from time to time.
+ */
+void resctrl_refresh_info();
+
+/**
+ * Returns the maximum bit mask available for L3.
  */
 uint64_t get_cbm_mask_as_uint();
 
 /**
- * Returns the minimum number of consecutive bits that must be set.
+ * Returns the minimum number of consecutive bits that must be set for L3.
  */
 unsigned int get_min_cbm_bits();
 
 /**
- * Returns the number of unique COS configurations available.
+ * Returns the number of unique COS configurations available for L3.
  */
 unsigned int get_num_closids();
 
+/**
+ * Same as get_cbm_mask_as_uint / get_min_cbm_bits / get_num_closids, but for the
+ * cache resource @p res instead of L3.
+ */
+uint64_t get_resource_cbm_mask(enum resctrl_resource res);
+unsigned int get_resource_min_cbm_bits(enum resctrl_resource res);
+unsigned int get_resource_num_closids(enum resctrl_resource res);
+
+/**
+ * Stores the ids of the domains (i.e. cache ids) of @p res in @p domains, at most @p size.
+ * Domain ids are not necessarily consecutive, e.g. 0 and 2 on systems with sub-NUMA
+ * clustering. Returns the number of domains.
+ */
+size_t get_resource_domains(enum resctrl_resource res, unsigned int *domains, size_t size);
+
+/**
+ * Stores the CPUs of the @p domain of @p res in @p cpus, at most @p size.
+ * Returns the number of CPUs in the domain.
+ */
+size_t get_domain_cpus(enum resctrl_resource res, unsigned int domain, size_t *cpus, size_t size);
+
+/**
+ * Returns the NUMA node of the @p domain of @p res.
+ */
+size_t get_domain_numa_node(enum resctrl_resource res, unsigned int domain);
+
+/**
+ * Returns the name of @p res as used in the schemata file and the info directory.
+ */
+const char *resctrl_resource_name(enum resctrl_resource res);
+
+/**
+ * Returns the minimum memory bandwidth percentage that can be requested.
+ */
+unsigned int get_mb_min_bandwidth();
+
+/**
+ * Returns the granularity in which the memory bandwidth percentage can be set.
+ */
+unsigned int get_mb_bandwidth_gran();
+
+/**
+ * Returns 1 if resctrl is mounted with the mba_MBps option, i.e. memory bandwidth is
+ * controlled in MBps by the kernel software controller, 0 otherwise.
+ */
+int get_mba_mbps_mode();
+
+/**
+ * Samples the monitoring counters of the ressource group @p name for all L3 domains.
+ * Counters that are not available are set to PONRI_MON_UNAVAILABLE.
+ */
+void resgroup_sample_mon(const char *name, struct resgroup_mon_stat *stat);
+
+/**
+ * Computes the memory bandwidth between two samples @p first and @p second of the same
+ * ressource group. Bandwidths of unavailable counters are 0. The kernel reports the
+ * counters as 64 bit values that do not wrap, a counter that went backwards was reset
+ * (e.g. the group was recreated in between) and its bandwidth is 0 as well.
+ */
+void resgroup_mon_stat_rate(const struct resgroup_mon_stat *first, const struct resgroup_mon_stat *second,
+							struct resgroup_mon_rate *rate);
+
+/**
+ * Creates the monitoring group @p name in the ressource group @p group ("" for the
+ * default group). Monitoring groups use an RMID but no CLOSID, i.e. tasks added to it
+ * keep the schemata of @p group. Fails if all RMIDs are in use.
+ */
+void resgroup_mon_create(const char *group, const char *name);
+
+/**
+ * Deletes the monitoring group @p name in the ressource group @p group.
+ */
+void resgroup_mon_delete(const char *group, const char *name);
+
+/**
+ * Adds the calling thread to the monitoring group @p name in the ressource group @p group.
+ */
+void resgroup_mon_add_me(const char *group, const char *name);
+
+/**
+ * Adds a given thread to the monitoring group @p name in the ressource group @p group.
+ * The thread must already be in @p group.
+ */
+void resgroup_mon_add_task(const char *group, const char *name, pid_t tid);
+
+/**
+ * Samples the monitoring counters of the monitoring group @p name in the ressource
+ * group @p group, see resgroup_sample_mon.
+ */
+void resgroup_mon_sample(const char *group, const char *name, struct resgroup_mon_stat *stat);
+
+/**
+ * Returns the number of RMIDs available, i.e. the maximum number of ressource groups
+ * and monitoring groups (including the default group).
+ */
+unsigned int get_num_rmids();
+
+/**
+ * Returns the number of RMIDs currently used by ressource groups and monitoring groups.
+ */
+unsigned int get_num_used_rmids();
+
+/**
+ * No-throw variants of the functions above, safe to be called from C. They return 0 on
+ * success or an errno code, e.g. ESRCH if the task passed to resgroup_add_task_r already
+ * exited, ENOSPC if no RMID is left for resgroup_mon_create_r, ENODEV if resctrl (or MB
+ * for resgroup_set_mb_r) is not available, EINVAL for more values than domains, ENOMEM if
+ * an allocation failed and EIO for any other error. They build the
+ * path names on the heap, so they are not async-signal-safe.
+ * The functions without the _r suffix throw a std::system_error (a std::runtime_error)
+ * with the same code.
+ * Functions that only read or sample (resgroup_get_*, resgroup_sample_mon,
+ * resctrl_get_info, get_num_rmids, ...) have no _r variant and may throw.
+ */
+int resgroup_create_r(const char *name);
+int resgroup_delete_r(const char *name);
+int resgroup_add_me_r(const char *name);
+int resgroup_add_task_r(const char *name, pid_t tid);
+int resgroup_set_cpus_r(const char *name, const size_t *cpus, size_t size);
+int resgroup_set_schemata_r(const char *name, const size_t *schematas, size_t size);
+int resgroup_set_resource_schemata_r(const char *name, enum resctrl_resource res, const size_t *schematas,
+									 size_t size);
+int resgroup_set_mb_r(const char *name, const size_t *bandwidths, size_t size);
+int resgroup_set_schemata_entry_r(const char *name, const char *resource, unsigned int domain, uint64_t value);
+int resgroup_mon_create_r(const char *group, const char *name);
+int resgroup_mon_delete_r(const char *group, const char *name);
+int resgroup_mon_add_me_r(const char *group, const char *name);
+int resgroup_mon_add_task_r(const char *group, const char *name, pid_t tid);
+
 #endif /* end of include guard: ponri_h */
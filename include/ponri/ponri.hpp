@@ -17,6 +17,15 @@
 #define ponri_hpp
 
 #include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
 #ifdef __cplusplus
@@ -29,8 +38,16 @@ extern "C" {
 } /* end extern "C" */
 
 /* Start of the C++ only functions. */
-// TODO add enum parameter to select L2 or L3
-inline std::bitset<64> get_cbm_mask() { return std::bitset<64>(get_cbm_mask_as_uint()); }
+
+// the classes below remember the context of the thread creating them, see ponci_context in ponci.h
+struct ponci_context;
+
+inline std::bitset<64> get_cbm_mask(resctrl_resource res = RESCTRL_L3) {
+	return std::bitset<64>(get_resource_cbm_mask(res));
+}
+
+std::vector<unsigned int> get_resource_domains(resctrl_resource res = RESCTRL_L3);
+std::vector<size_t> get_domain_cpus(unsigned int domain, resctrl_resource res = RESCTRL_L3);
 
 inline void resgroup_create(const std::string &name) { resgroup_create(name.c_str()); }
 inline void resgroup_delete(const std::string &name) { resgroup_delete(name.c_str()); }
@@ -39,9 +56,308 @@ inline void resgroup_add_task(const std::string &name, const pid_t tid) { resgro
 
 void resgroup_set_cpus(const std::string &name, const std::vector<size_t> &cpus);
 void resgroup_set_schemata(const std::string &name, const std::vector<size_t> &schematas);
-std::bitset<64> create_minimal_bitset();
+void resgroup_set_schemata(const std::string &name, resctrl_resource res, const std::vector<size_t> &schematas);
+void resgroup_set_mb(const std::string &name, const std::vector<size_t> &bandwidths);
+
+/**
+ * Content of a schemata file. Maps the resource name (e.g. "L3", "MB") to the value of
+ * every domain id. Values of cache resources are bit masks, values of MB are percentages
+ * or MBps.
+ */
+using resgroup_schemata = std::map<std::string, std::map<unsigned int, uint64_t>>;
+
+/**
+ * Reads and parses the schemata file of the ressource group @p name.
+ */
+resgroup_schemata resgroup_get_schemata(const std::string &name);
+
+/**
+ * Reads the size file of the ressource group @p name, i.e. the number of bytes of every
+ * cache domain available to the group. The values of MB are the same as in the schemata.
+ */
+resgroup_schemata resgroup_get_size(const std::string &name);
+
+/**
+ * Writes the entries in @p entries to the schemata file of the ressource group @p name.
+ * Resources and domains not in @p entries keep their current value.
+ */
+void resgroup_write_schemata(const std::string &name, const resgroup_schemata &entries);
+
+/**
+ * Returns the entries of @p desired that differ from @p current.
+ */
+resgroup_schemata resgroup_schemata_diff(const resgroup_schemata &current, const resgroup_schemata &desired);
+
+/**
+ * Sets the schemata of the ressource group @p name to @p desired, but only writes the
+ * entries that differ from the current schemata.
+ */
+void resgroup_update_schemata(const std::string &name, const resgroup_schemata &desired);
+
+std::bitset<64> create_minimal_bitset(resctrl_resource res = RESCTRL_L3);
 std::bitset<64> increase_bitset(std::bitset<64> bits);
 
+inline resgroup_mon_stat resgroup_sample_mon(const std::string &name) {
+	resgroup_mon_stat stat;
+	resgroup_sample_mon(name.c_str(), &stat);
+	return stat;
+}
+
+inline void resgroup_mon_create(const std::string &group, const std::string &name) {
+	resgroup_mon_create(group.c_str(), name.c_str());
+}
+inline void resgroup_mon_delete(const std::string &group, const std::string &name) {
+	resgroup_mon_delete(group.c_str(), name.c_str());
+}
+inline void resgroup_mon_add_me(const std::string &group, const std::string &name) {
+	resgroup_mon_add_me(group.c_str(), name.c_str());
+}
+inline void resgroup_mon_add_task(const std::string &group, const std::string &name, const pid_t tid) {
+	resgroup_mon_add_task(group.c_str(), name.c_str(), tid);
+}
+
+inline resgroup_mon_stat resgroup_mon_sample(const std::string &group, const std::string &name) {
+	resgroup_mon_stat stat;
+	resgroup_mon_sample(group.c_str(), name.c_str(), &stat);
+	return stat;
+}
+
+inline resgroup_mon_rate resgroup_mon_stat_rate(const resgroup_mon_stat &first, const resgroup_mon_stat &second) {
+	resgroup_mon_rate rate;
+	resgroup_mon_stat_rate(&first, &second, &rate);
+	return rate;
+}
+
+/**
+ * Thrown by cbm_allocator if a request does not fit into the free bits of a domain.
+ * A failed schemata write throws std::system_error instead.
+ */
+class cbm_allocation_error : public std::runtime_error {
+  public:
+	explicit cbm_allocation_error(const std::string &what) : std::runtime_error(what) {}
+};
+
+/**
+ * Hands out non-overlapping, contiguous capacity bit masks of the cache resource @p res
+ * to ressource groups, independently for every domain. Bits in info/<res>/shareable_bits
+ * and bits used by hardware or pseudo-locked / exclusive regions (see info/<res>/bit_usage)
+ * are never handed out. Neither are the bits of ressource groups that already have a
+ * partition (a mask smaller than the full mask) when the allocator is created, until
+ * such a group is allocated by the allocator itself. If a request does not fit, but
+ * there are enough free bits, the existing allocations are compacted. Allocations are
+ * only moved if the request fits after the compaction.
+ * Every change (including moves during compaction) is written to the schemata of the
+ * affected ressource groups, only the entry of the modified domain is written. The
+ * allocation of a group is only changed if its write succeeds.
+ * Not thread-safe, concurrent users (like cache_controller) must serialize their calls.
+ * All member functions use the context of the thread creating the allocator.
+ */
+class cbm_allocator {
+  public:
+	explicit cbm_allocator(resctrl_resource res = RESCTRL_L3);
+
+	/**
+	 * Allocates @p ways contiguous bits in @p domain to ressource group @p group and
+	 * returns the new bit mask. Throws cbm_allocation_error if there are not enough free bits.
+	 */
+	uint64_t allocate(const std::string &group, unsigned int domain, unsigned int ways);
+
+	/**
+	 * Changes the allocation of @p group in @p domain to @p ways bits. The allocation
+	 * is kept in place if possible. Throws cbm_allocation_error and keeps the old allocation
+	 * if there are not enough free bits.
+	 */
+	uint64_t resize(const std::string &group, unsigned int domain, unsigned int ways);
+
+	/**
+	 * Same as allocate / resize, but with the cache capacity in bytes. The capacity is
+	 * rounded up to full ways.
+	 */
+	uint64_t allocate_bytes(const std::string &group, unsigned int domain, uint64_t bytes);
+	uint64_t resize_bytes(const std::string &group, unsigned int domain, uint64_t bytes);
+
+	/**
+	 * Returns the number of bytes of a single way in @p domain.
+	 */
+	uint64_t way_size(unsigned int domain) const { return state(domain).way_size; }
+
+	/**
+	 * Releases the allocation of @p group in @p domain. The schemata of @p group is not
+	 * modified.
+	 */
+	void free(const std::string &group, unsigned int domain);
+
+	/**
+	 * Returns the bit mask allocated to @p group in @p domain, 0 if there is none.
+	 */
+	uint64_t mask(const std::string &group, unsigned int domain) const;
+
+	/**
+	 * Returns the number of bits not allocated and not reserved in @p domain.
+	 */
+	unsigned int free_ways(unsigned int domain) const;
+
+	unsigned int ways() const { return num_ways; }
+	unsigned int min_ways() const { return min_cbm_bits; }
+
+  private:
+	struct domain_state {
+		uint64_t reserved;
+		uint64_t way_size;
+		std::map<std::string, uint64_t> allocations;
+		// partitions of the groups not managed by us, read on construction
+		std::map<std::string, uint64_t> foreign;
+	};
+
+	domain_state &state(unsigned int domain);
+	const domain_state &state(unsigned int domain) const;
+	uint64_t fixed(const domain_state &dom, const std::string &ignore) const;
+	uint64_t used(const domain_state &dom, const std::string &ignore) const;
+	unsigned int bytes_to_ways(unsigned int domain, uint64_t bytes) const;
+	bool find_free(uint64_t used_bits, unsigned int ways, uint64_t &mask) const;
+	std::map<std::string, uint64_t> plan_compaction(const domain_state &dom, const std::string &ignore,
+													uint64_t &used_bits) const;
+	void apply_compaction(unsigned int domain, const std::map<std::string, uint64_t> &plan);
+	void apply(const std::string &group, unsigned int domain, uint64_t mask) const;
+
+	ponci_context *context;
+	resctrl_resource res;
+	unsigned int num_ways;
+	unsigned int min_cbm_bits;
+	std::map<unsigned int, domain_state> domains;
+};
+
+/**
+ * Pool of pre-created ressource groups, one per available CLOSID. Callers lease a group
+ * with a requested schemata and release it when done, groups are never deleted while
+ * the pool exists. Callers requesting the same schemata share a group, i.e. a CLOSID.
+ * A lease writes the full schemata: the schemata of the default group at pool creation,
+ * overridden by the requested entries. Nothing set by a previous lessee is inherited.
+ * All member functions are thread-safe and use the context of the thread creating the pool.
+ */
+class resgroup_pool {
+  public:
+	/**
+	 * Creates @p size ressource groups named @p prefix0, @p prefix1, ... If @p size is 0
+	 * one group per CLOSID not used by the default group or an existing ressource group is
+	 * created. If the constructor throws, the groups it created are deleted.
+	 */
+	explicit resgroup_pool(const std::string &prefix = "ponri_pool", size_t size = 0);
+
+	/**
+	 * Moves all remaining tasks to the default group and deletes the groups.
+	 */
+	~resgroup_pool();
+
+	resgroup_pool(const resgroup_pool &) = delete;
+	resgroup_pool &operator=(const resgroup_pool &) = delete;
+
+	/**
+	 * Returns the name of a group configured with @p schemata. Throws if all groups are
+	 * leased with other schematas.
+	 */
+	std::string lease(const resgroup_schemata &schemata);
+
+	/**
+	 * Releases a group returned by lease. When the last lease of a group is released its
+	 * remaining tasks are moved to the default group.
+	 */
+	void release(const std::string &group);
+
+	size_t size() const { return groups.size(); }
+	size_t leased() const;
+
+  private:
+	struct entry {
+		std::string name;
+		resgroup_schemata schemata;
+		size_t leases;
+	};
+
+	ponci_context *context;
+	resgroup_schemata templ;
+	std::vector<entry> groups;
+	mutable std::mutex mutex;
+};
+
+/**
+ * Parameters of the cache_controller.
+ * A group grows by one way if its LLC occupancy exceeds @p grow_threshold of its
+ * partition and shrinks by one way if it falls below @p shrink_threshold. A decision
+ * must be the same for @p hysteresis consecutive steps before it is applied.
+ * If a throughput signal is available and growing did not improve it by at least
+ * @p min_gain (relative), the group is not grown again for @p cooldown steps. Without a
+ * throughput signal the memory bandwidth of the group (mbm_total_bytes, mbm_local_bytes if
+ * the total is not available) is used instead, growing must reduce it by @p min_gain.
+ */
+struct cache_controller_config {
+	double grow_threshold = 0.9;
+	double shrink_threshold = 0.5;
+	unsigned int hysteresis = 3;
+	double min_gain = 0.02;
+	unsigned int cooldown = 10;
+	unsigned int max_ways = 0; /* 0: no limit */
+};
+
+/**
+ * Adapts the cache partitions of ressource groups to their working sets. Every step()
+ * samples llc_occupancy and the memory bandwidth of all groups (and their throughput, if
+ * given) and resizes the partitions with the cbm_allocator. step() can be called by the
+ * user or periodically by a background thread started with start(). The background thread
+ * keeps running if step() throws, stop() (and start()) rethrow the last exception.
+ * All member functions are thread-safe.
+ */
+class cache_controller {
+  public:
+	explicit cache_controller(cbm_allocator &allocator, const cache_controller_config &config = {});
+	~cache_controller();
+
+	cache_controller(const cache_controller &) = delete;
+	cache_controller &operator=(const cache_controller &) = delete;
+
+	/**
+	 * Controls the partition of @p group in @p domain, starting with @p ways ways.
+	 * @p throughput is an optional application specific metric, higher is better.
+	 */
+	void add_group(const std::string &group, unsigned int domain, unsigned int ways,
+				   std::function<double()> throughput = nullptr);
+
+	/**
+	 * Stops controlling @p group and frees its partition.
+	 */
+	void remove_group(const std::string &group);
+
+	void step();
+
+	void start(std::chrono::milliseconds interval);
+	void stop();
+
+  private:
+	struct controlled_group {
+		std::string name;
+		unsigned int domain;
+		std::function<double()> throughput;
+		int pending;
+		unsigned int streak;
+		unsigned int cooldown;
+		bool grew;
+		double last_throughput;
+		double last_bandwidth;
+		bool has_sample;
+		resgroup_mon_stat last_sample;
+	};
+
+	cbm_allocator &allocator;
+	cache_controller_config config;
+	std::vector<controlled_group> groups;
+	std::mutex mutex;
+
+	std::thread worker;
+	std::condition_variable cv;
+	bool running = false;
+	std::exception_ptr last_error;
+};
+
 #endif /* end of the c++ only functions */
 
 #endif /* end of include guard: ponri_hpp */
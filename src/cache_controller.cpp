@@ -0,0 +1,176 @@
+/**
+ * po     n  r       i
+ * poor mans resctrl interface
+ *
+ * Copyright 2016 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <ponci/ponci.hpp>
+#include <ponri/ponri.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static double memory_bandwidth(const resgroup_mon_stat &first, const resgroup_mon_stat &second,
+							   unsigned int domain);
+
+cache_controller::cache_controller(cbm_allocator &_allocator, const cache_controller_config &_config)
+	: allocator(_allocator), config(_config) {}
+
+cache_controller::~cache_controller() {
+	// never throw from the destructor
+	try {
+		stop();
+	} catch (...) {
+	}
+}
+
+void cache_controller::add_group(const std::string &group, unsigned int domain, unsigned int ways,
+								 std::function<double()> throughput) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	allocator.allocate(group, domain, ways);
+	groups.push_back(controlled_group{group, domain, throughput, 0, 0, 0, false, 0.0, 0.0, false, resgroup_mon_stat()});
+}
+
+void cache_controller::remove_group(const std::string &group) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto it = std::find_if(groups.begin(), groups.end(),
+								 [&group](const controlled_group &g) { return g.name == group; });
+	if (it == groups.end()) return;
+
+	allocator.free(it->name, it->domain);
+	groups.erase(it);
+}
+
+void cache_controller::step() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const unsigned int max_ways = config.max_ways == 0 ? allocator.ways() : config.max_ways;
+
+	for (auto &group : groups) {
+		const auto stat = resgroup_sample_mon(group.name);
+		const auto pos = std::find(stat.domains, stat.domains + stat.num_domains, group.domain);
+		if (pos == stat.domains + stat.num_domains) continue;
+		const uint64_t occupancy = stat.llc_occupancy[pos - stat.domains];
+		if (occupancy == PONRI_MON_UNAVAILABLE) continue;
+
+		const auto ways = static_cast<unsigned int>(__builtin_popcountll(allocator.mask(group.name, group.domain)));
+		const double capacity = static_cast<double>(ways) * static_cast<double>(allocator.way_size(group.domain));
+		const double fill = capacity == 0.0 ? 0.0 : static_cast<double>(occupancy) / capacity;
+
+		const double bandwidth = group.has_sample ? memory_bandwidth(group.last_sample, stat, group.domain) : 0.0;
+		group.last_sample = stat;
+		group.has_sample = true;
+
+		// check if the last growth paid off, a larger partition reduces the memory traffic of the group
+		if (group.throughput) {
+			const double throughput = group.throughput();
+			if (group.grew && throughput < group.last_throughput * (1.0 + config.min_gain)) {
+				group.cooldown = config.cooldown;
+			}
+			group.last_throughput = throughput;
+		} else if (bandwidth > 0.0) {
+			const bool paid_off = bandwidth <= group.last_bandwidth * (1.0 - config.min_gain);
+			if (group.grew && group.last_bandwidth > 0.0 && !paid_off) {
+				group.cooldown = config.cooldown;
+			}
+			group.last_bandwidth = bandwidth;
+		}
+		group.grew = false;
+		if (group.cooldown > 0) --group.cooldown;
+
+		int want = 0;
+		if (fill >= config.grow_threshold && group.cooldown == 0 && ways < max_ways) {
+			want = 1;
+		} else if (fill <= config.shrink_threshold && ways > allocator.min_ways()) {
+			want = -1;
+		}
+
+		if (want != group.pending) {
+			group.pending = want;
+			group.streak = 0;
+		}
+		if (want == 0 || ++group.streak < config.hysteresis) continue;
+
+		group.streak = 0;
+		try {
+			allocator.resize(group.name, group.domain, static_cast<unsigned int>(static_cast<int>(ways) + want));
+			group.grew = want > 0;
+		} catch (const cbm_allocation_error &) {
+			// not enough free ways, try again in the next step. Write errors are reported through stop()
+		}
+	}
+}
+
+void cache_controller::start(std::chrono::milliseconds interval) {
+	stop();
+
+	running = true;
+	// the worker thread manages the groups of the context of the calling thread
+	const auto ctx = ponci_context_current();
+	worker = std::thread([this, interval, ctx]() {
+		ponci_context_guard guard(ctx);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (running) {
+			cv.wait_for(lock, interval);
+			if (!running) break;
+
+			// an exception must not terminate the process, it is rethrown by stop()
+			lock.unlock();
+			std::exception_ptr error;
+			try {
+				step();
+			} catch (...) {
+				error = std::current_exception();
+			}
+			lock.lock();
+			if (error) last_error = error;
+		}
+	});
+}
+
+void cache_controller::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	cv.notify_all();
+
+	if (worker.joinable()) worker.join();
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(error, last_error);
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+// bandwidth of the group in domain between two samples, 0 if the counters are not available
+static double memory_bandwidth(const resgroup_mon_stat &first, const resgroup_mon_stat &second,
+							   unsigned int domain) {
+	resgroup_mon_rate rate;
+	resgroup_mon_stat_rate(&first, &second, &rate);
+
+	for (size_t i = 0; i < rate.num_domains; ++i) {
+		if (rate.domains[i] == domain) return rate.mbm_total[i] > 0.0 ? rate.mbm_total[i] : rate.mbm_local[i];
+	}
+	return 0.0;
+}
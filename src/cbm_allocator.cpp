@@ -0,0 +1,280 @@
+/**
+ * po     n  r       i
+ * poor mans resctrl interface
+ *
+ * Copyright 2016 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <ponci/ponci.hpp>
+#include <ponri/ponri.hpp>
+
+#include "fileIO_helper.hpp"
+#include "ponri_internal.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdlib>
+
+static inline uint64_t contiguous_bits(unsigned int first, unsigned int ways);
+static inline unsigned int popcount(uint64_t bits);
+
+cbm_allocator::cbm_allocator(resctrl_resource _res) : context(ponci_context_current()), res(_res) {
+	const std::string info = resgroup_path("info/") + resctrl_resource_name(res) + "/";
+
+	const auto &cache = resctrl_get_info()->cache[res];
+	if (cache.available == 0) throw std::runtime_error(std::string(resctrl_resource_name(res)) + " not available.");
+
+	num_ways = popcount(cache.cbm_mask);
+	min_cbm_bits = cache.min_cbm_bits;
+	const uint64_t shareable = cache.shareable_bits;
+
+	// the size of a way is the size of the default group divided by the number of its bits
+	const auto name = resctrl_resource_name(res);
+	const auto size = resgroup_get_size("");
+	const auto schemata = resgroup_get_schemata("");
+	for (const auto domain : get_resource_domains(res)) {
+		auto &dom = domains[domain];
+		dom.reserved = shareable;
+		dom.way_size = 0;
+
+		const auto bits = popcount(schemata.at(name).at(domain));
+		const auto size_line = size.find(name);
+		if (bits != 0 && size_line != size.end() && size_line->second.count(domain) != 0) {
+			dom.way_size = size_line->second.at(domain) / bits;
+		}
+	}
+
+	// partitions of groups we do not manage must not be handed out again. A group with the full mask (the
+	// default of a new group) shares the whole cache and does not claim a partition.
+	const uint64_t full = contiguous_bits(0, num_ways);
+	for (const auto &group : list_resgroups()) {
+		const auto group_schemata = resgroup_get_schemata(group);
+		const auto entry = group_schemata.find(name);
+		if (entry == group_schemata.end()) continue;
+
+		for (const auto &domain : entry->second) {
+			const auto dom = domains.find(domain.first);
+			if (dom == domains.end() || (domain.second & full) == full) continue;
+			dom->second.foreign[group] = domain.second;
+		}
+	}
+
+	/*
+	 $ cat /sys/fs/resctrl/info/L3/bit_usage
+	 0=SSSSSSSSSSSS;1=SSSSSSSHHSSS
+	 the leftmost character is the highest bit
+	 */
+	std::vector<char> buf;
+	read_file_to_vector((info + "bit_usage").c_str(), buf, true);
+	const char *pos = buf.data();
+	while (*pos != '\0' && *pos != '\n') {
+		char *end;
+		const auto domain = static_cast<unsigned int>(strtoul(pos, &end, 10));
+		if (end == pos || *end != '=') break;
+		pos = end + 1;
+
+		const char *first = pos;
+		while (*pos != ';' && *pos != '\n' && *pos != '\0') ++pos;
+		const auto width = static_cast<unsigned int>(pos - first);
+
+		uint64_t reserved = 0;
+		for (unsigned int i = 0; i < width; ++i) {
+			const char c = first[width - 1 - i];
+			if (c == 'H' || c == 'X' || c == 'P' || c == 'E') reserved |= 1ull << i;
+		}
+		domains[domain].reserved |= reserved;
+
+		if (*pos == ';') ++pos;
+	}
+}
+
+uint64_t cbm_allocator::allocate(const std::string &group, unsigned int domain, unsigned int ways) {
+	ponci_context_guard guard(context);
+	auto &dom = state(domain);
+	if (dom.allocations.count(group) != 0) return resize(group, domain, ways);
+
+	ways = std::max(ways, min_cbm_bits);
+	// a partition the group had before we managed it is given up by the new allocation
+	const uint64_t used_bits = used(dom, group);
+	if (ways > num_ways - popcount(used_bits & contiguous_bits(0, num_ways))) {
+		throw cbm_allocation_error("Not enough free cache ways in libponri.");
+	}
+
+	uint64_t mask;
+	if (!find_free(used_bits, ways, mask)) {
+		// the allocations are only moved if the request fits afterwards
+		uint64_t compacted;
+		const auto plan = plan_compaction(dom, group, compacted);
+		if (!find_free(compacted, ways, mask)) throw cbm_allocation_error("Cache ways too fragmented in libponri.");
+		apply_compaction(domain, plan);
+	}
+
+	// the allocation is only recorded once the kernel has it
+	apply(group, domain, mask);
+	dom.foreign.erase(group);
+	dom.allocations[group] = mask;
+	return mask;
+}
+
+uint64_t cbm_allocator::resize(const std::string &group, unsigned int domain, unsigned int ways) {
+	ponci_context_guard guard(context);
+	auto &dom = state(domain);
+	const auto it = dom.allocations.find(group);
+	if (it == dom.allocations.end()) return allocate(group, domain, ways);
+
+	ways = std::max(ways, min_cbm_bits);
+	const uint64_t old_mask = it->second;
+
+	// try to keep the start of the allocation
+	unsigned int first = 0;
+	while ((old_mask & (1ull << first)) == 0) ++first;
+
+	const uint64_t others = used(dom, group);
+
+	uint64_t mask = contiguous_bits(first, ways);
+	if (first + ways > num_ways || (mask & others) != 0) {
+		if (ways > num_ways - popcount(others & contiguous_bits(0, num_ways))) {
+			throw cbm_allocation_error("Not enough free cache ways in libponri.");
+		}
+
+		if (!find_free(others, ways, mask)) {
+			// the allocations are only moved if the request fits afterwards
+			uint64_t compacted;
+			const auto plan = plan_compaction(dom, group, compacted);
+			if (!find_free(compacted, ways, mask)) throw cbm_allocation_error("Cache ways too fragmented in libponri.");
+			apply_compaction(domain, plan);
+		}
+	}
+
+	// the old allocation is kept if the write fails
+	if (mask != old_mask) apply(group, domain, mask);
+	dom.allocations[group] = mask;
+	return mask;
+}
+
+uint64_t cbm_allocator::allocate_bytes(const std::string &group, unsigned int domain, uint64_t bytes) {
+	return allocate(group, domain, bytes_to_ways(domain, bytes));
+}
+
+uint64_t cbm_allocator::resize_bytes(const std::string &group, unsigned int domain, uint64_t bytes) {
+	return resize(group, domain, bytes_to_ways(domain, bytes));
+}
+
+void cbm_allocator::free(const std::string &group, unsigned int domain) { state(domain).allocations.erase(group); }
+
+uint64_t cbm_allocator::mask(const std::string &group, unsigned int domain) const {
+	const auto &dom = state(domain);
+	const auto it = dom.allocations.find(group);
+	return it == dom.allocations.end() ? 0 : it->second;
+}
+
+unsigned int cbm_allocator::free_ways(unsigned int domain) const {
+	return num_ways - popcount(used(state(domain), "") & contiguous_bits(0, num_ways));
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+cbm_allocator::domain_state &cbm_allocator::state(unsigned int domain) {
+	const auto it = domains.find(domain);
+	if (it == domains.end()) throw std::runtime_error("Unknown cache domain in libponri.");
+	return it->second;
+}
+
+const cbm_allocator::domain_state &cbm_allocator::state(unsigned int domain) const {
+	const auto it = domains.find(domain);
+	if (it == domains.end()) throw std::runtime_error("Unknown cache domain in libponri.");
+	return it->second;
+}
+
+// bits that are reserved or used by a group not managed by us, except for the group ignore
+uint64_t cbm_allocator::fixed(const domain_state &dom, const std::string &ignore) const {
+	uint64_t bits = dom.reserved;
+	for (const auto &group : dom.foreign) {
+		if (group.first != ignore) bits |= group.second;
+	}
+	return bits;
+}
+
+// bits that are reserved or used by any group, except for the group ignore
+uint64_t cbm_allocator::used(const domain_state &dom, const std::string &ignore) const {
+	uint64_t bits = fixed(dom, ignore);
+	for (const auto &allocation : dom.allocations) {
+		if (allocation.first != ignore) bits |= allocation.second;
+	}
+	return bits;
+}
+
+unsigned int cbm_allocator::bytes_to_ways(unsigned int domain, uint64_t bytes) const {
+	const uint64_t size = way_size(domain);
+	if (size == 0) throw std::runtime_error("Cache size of domain unknown in libponri.");
+
+	return static_cast<unsigned int>((bytes + size - 1) / size);
+}
+
+// first fit search for ways contiguous bits not in used_bits
+bool cbm_allocator::find_free(uint64_t used_bits, unsigned int ways, uint64_t &mask) const {
+	for (unsigned int first = 0; first + ways <= num_ways; ++first) {
+		const uint64_t candidate = contiguous_bits(first, ways);
+		if ((candidate & used_bits) == 0) {
+			mask = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+// plans to move all allocations of dom as far as possible to the lowest bits, keeping their order. Returns the
+// new masks, used_bits are the bits used afterwards. The partition of ignore is not kept.
+std::map<std::string, uint64_t> cbm_allocator::plan_compaction(const domain_state &dom, const std::string &ignore,
+															   uint64_t &used_bits) const {
+	std::vector<std::pair<uint64_t, std::string>> by_position;
+	for (const auto &allocation : dom.allocations) {
+		if (allocation.first != ignore) by_position.emplace_back(allocation.second, allocation.first);
+	}
+	std::sort(by_position.begin(), by_position.end());
+
+	std::map<std::string, uint64_t> plan;
+	used_bits = fixed(dom, ignore);
+	for (const auto &allocation : by_position) {
+		const unsigned int ways = popcount(allocation.first);
+
+		uint64_t mask = allocation.first;
+		find_free(used_bits, ways, mask);
+		used_bits |= mask;
+		plan[allocation.second] = mask;
+	}
+	return plan;
+}
+
+// a group keeps its old mask if its write fails, the groups moved before keep their new masks
+void cbm_allocator::apply_compaction(unsigned int domain, const std::map<std::string, uint64_t> &plan) {
+	auto &dom = state(domain);
+	for (const auto &allocation : plan) {
+		auto &mask = dom.allocations.at(allocation.first);
+		if (mask == allocation.second) continue;
+
+		apply(allocation.first, domain, allocation.second);
+		mask = allocation.second;
+	}
+}
+
+void cbm_allocator::apply(const std::string &group, unsigned int domain, uint64_t mask) const {
+	resgroup_set_schemata_entry(group.c_str(), resctrl_resource_name(res), domain, mask);
+}
+
+static inline uint64_t contiguous_bits(unsigned int first, unsigned int ways) {
+	const uint64_t bits = ways >= 64 ? ~0ull : (1ull << ways) - 1;
+	return bits << first;
+}
+
+static inline unsigned int popcount(uint64_t bits) { return static_cast<unsigned int>(__builtin_popcountll(bits)); }
@@ -0,0 +1,146 @@
+/**
+ * po     n  c       i
+ * poor mans cgroups interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "ponci/ponci.hpp"
+
+#include "context.hpp"
+#include "fileIO_helper.hpp"
+#include "rollback_helper.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cerrno>
+
+static void move_tasks(const std::string &from, const std::string &to);
+static void delete_groups(const std::vector<std::string> &names, const std::string &parent);
+
+cgroup_pool::cgroup_pool(const std::string &_parent, size_t size, const cgroup_template &_templ,
+						 const std::string &prefix)
+	: context(ponci_context_current()), parent(_parent), templ(_templ) {
+	// tasks can only be added to a cpuset with CPUs and memory nodes
+	if (templ.cpus.empty()) templ.cpus = cgroup_get_cpus(parent);
+	if (templ.mems.empty()) templ.mems = cgroup_get_mems(parent);
+	// lease compares the template with the sorted lists read from the kernel
+	for (auto *list : {&templ.cpus, &templ.mems}) {
+		std::sort(list->begin(), list->end());
+		list->erase(std::unique(list->begin(), list->end()), list->end());
+	}
+
+	const std::string path = parent.empty() ? prefix : parent + "/" + prefix;
+	std::vector<std::string> created;
+	auto undo = make_rollback([&created, this] { delete_groups(created, parent); });
+	for (size_t i = 0; i < size; ++i) {
+		const std::string name = path + std::to_string(i);
+		cgroup_create(name);
+		created.push_back(name);
+
+		cgroup_set_cpus(name, templ.cpus);
+		cgroup_set_mems(name, templ.mems);
+	}
+	for (const auto &name : created) groups.push_back(entry{name, false});
+	undo.commit();
+}
+
+cgroup_pool::~cgroup_pool() {
+	ponci_context_guard guard(context);
+	std::vector<std::string> names;
+	for (const auto &group : groups) names.push_back(group.name);
+	delete_groups(names, parent);
+}
+
+std::string cgroup_pool::lease() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto &group : groups) {
+		if (group.leased) continue;
+
+		ponci_context_guard guard(context);
+		// the previous lessee may have changed the attributes, reading is cheaper than a write. Changes made
+		// outside of the write cache are not known to it, its entries would skip the reset.
+		const bool reset_cpus = cgroup_get_cpus(group.name) != templ.cpus;
+		const bool reset_mems = cgroup_get_mems(group.name) != templ.mems;
+		if (reset_cpus || reset_mems) current_context().cache.erase_group(group.name, false);
+		if (reset_cpus) cgroup_set_cpus(group.name, templ.cpus);
+		if (reset_mems) cgroup_set_mems(group.name, templ.mems);
+		// release thawed the group
+		if (templ.frozen) cgroup_freeze(group.name);
+
+		group.leased = true;
+		return group.name;
+	}
+
+	throw std::runtime_error("No free cgroup in pool in libponci.");
+}
+
+void cgroup_pool::release(const std::string &name) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto &group : groups) {
+		if (group.name != name) continue;
+
+		if (!group.leased) throw std::runtime_error("Cgroup is not leased in libponci.");
+
+		ponci_context_guard guard(context);
+		// the freezer may not be mounted
+		const int err = cgroup_thaw_r(group.name.c_str());
+		if (err != 0 && err != ENOENT) throw_on_error(err);
+		move_tasks(group.name, parent);
+
+		group.leased = false;
+		return;
+	}
+
+	throw std::runtime_error("Cgroup is not part of the pool in libponci.");
+}
+
+size_t cgroup_pool::leased() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t ret = 0;
+	for (const auto &group : groups) {
+		if (group.leased) ++ret;
+	}
+	return ret;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+// tasks may fork while being moved, so we repeat until the cgroup is empty
+static void move_tasks(const std::string &from, const std::string &to) {
+	auto tids = cgroup_get_tasks(from);
+	while (!tids.empty()) {
+		for (const auto tid : tids) {
+			// the task may have exited in the meantime
+			const int err = cgroup_add_task_r(to.c_str(), tid);
+			if (err != 0 && err != ESRCH) throw_on_error(err);
+		}
+		tids = cgroup_get_tasks(from);
+	}
+}
+
+// never throws, we clean up as much as possible. Also used if the constructor fails half way.
+static void delete_groups(const std::vector<std::string> &names, const std::string &parent) {
+	for (const auto &name : names) {
+		try {
+			cgroup_thaw_r(name.c_str());
+			move_tasks(name, parent);
+			cgroup_delete(name);
+		} catch (const std::runtime_error &) {
+		}
+	}
+}
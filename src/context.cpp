@@ -0,0 +1,216 @@
+/**
+ * po     n  c       i
+ * poor mans cgroups interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "ponci/ponci.hpp"
+#include "ponri/ponri.hpp"
+
+#include "context.hpp"
+#include "mountinfo.hpp"
+#include "write_cache.hpp"
+
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <linux/magic.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+// context of the calling thread, nullptr selects the default context
+static thread_local ponci_context *thread_context = nullptr;
+
+/////////////////////////////////////////////////////////////////
+// PROTOTYPES
+/////////////////////////////////////////////////////////////////
+static ponci_context &default_context();
+static ponci_context &context_or_default(ponci_context *ctx);
+static bool check_is_cgroup2(const std::string &path);
+static bool matches_current_value(const write_cache::entry &e);
+
+/////////////////////////////////////////////////////////////////
+// EXPORTED FUNCTIONS
+/////////////////////////////////////////////////////////////////
+struct ponci_context *ponci_context_create(const char *cgroup_root, const char *resctrl_root) {
+	return new ponci_context(cgroup_root != nullptr ? cgroup_root : "", resctrl_root != nullptr ? resctrl_root : "");
+}
+
+void ponci_context_destroy(struct ponci_context *ctx) {
+	if (ctx == thread_context) thread_context = nullptr;
+	delete ctx;
+}
+
+struct ponci_context *ponci_context_use(struct ponci_context *ctx) {
+	auto previous = &current_context();
+	thread_context = ctx;
+	return previous;
+}
+
+struct ponci_context *ponci_context_current() {
+	return &current_context();
+}
+
+void ponci_context_set_write_cache(struct ponci_context *ctx, int enable) {
+	auto &c = context_or_default(ctx);
+	c.cache_enabled.store(enable != 0);
+	if (enable == 0) c.cache.clear();
+}
+
+void ponci_context_invalidate(struct ponci_context *ctx) { context_or_default(ctx).cache.clear(); }
+
+size_t ponci_context_revalidate(struct ponci_context *ctx) {
+	auto &c = context_or_default(ctx);
+	ponci_context_guard guard(&c);
+
+	size_t dropped = 0;
+	for (const auto &e : c.cache.entries()) {
+		if (!matches_current_value(e)) {
+			c.cache.erase(e);
+			++dropped;
+		}
+	}
+
+	return dropped;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+ponci_context::ponci_context(const std::string &_cgroup_root, const std::string &_resctrl_root)
+	: cgroup_root(_cgroup_root), resctrl_root(_resctrl_root) {}
+
+ponci_context::~ponci_context() {
+	delete info.load();
+	for (auto old : retired_info) delete old;
+}
+
+const std::vector<std::string> &ponci_context::subsystems() {
+	std::call_once(subsystems_flag, [this] {
+		std::vector<std::string> ret;
+
+		if (!cgroup_root.empty()) {
+			struct stat st;
+			if (stat((cgroup_root + "cpuset").c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+				ret.emplace_back("cpuset");
+				ret.emplace_back("freezer");
+			} else {
+				ret.emplace_back("");
+			}
+		} else {
+			const auto &mounts = get_mount_table();
+			const auto cpuset = mounts.cgroup.find("cpuset");
+			if (cpuset != mounts.cgroup.end()) {
+				ret.emplace_back("cpuset");
+				// a co-mounted freezer shares the directory of the cpuset hierarchy
+				const auto freezer = mounts.cgroup.find("freezer");
+				if (freezer != mounts.cgroup.end() && freezer->second != cpuset->second) ret.emplace_back("freezer");
+			} else if (!mounts.cgroup2.empty()) {
+				ret.emplace_back("");
+			} else {
+				throw std::system_error(ENODEV, std::generic_category(),
+										"Neither the cgroup v1 cpuset controller nor cgroup v2 is mounted");
+			}
+		}
+
+		discovered_subsystems = ret;
+	});
+
+	return discovered_subsystems;
+}
+
+std::string ponci_context::subsystem_root(const std::string &subsystem) {
+	if (!cgroup_root.empty()) return cgroup_root + subsystem;
+
+	const auto &mounts = get_mount_table();
+	// all controllers live in the unified hierarchy
+	if (subsystems().front().empty()) return mounts.cgroup2;
+
+	const auto it = mounts.cgroup.find(subsystem);
+	if (it != mounts.cgroup.end()) return it->second;
+
+	// not mounted, accessing files below the default location reports the error
+	return std::string("/sys/fs/cgroup/") + subsystem;
+}
+
+bool ponci_context::is_cgroup2() {
+	std::call_once(cgroup2_flag, [this] {
+		cgroup2 = subsystems().size() == 1 && check_is_cgroup2(subsystem_root(subsystems().front()));
+	});
+
+	return cgroup2;
+}
+
+std::string ponci_context::resctrl_mount() const {
+	if (!resctrl_root.empty()) return resctrl_root;
+
+	const auto &mount_point = get_mount_table().resctrl;
+	return mount_point.empty() ? std::string("/sys/fs/resctrl") : mount_point;
+}
+
+ponci_context &current_context() { return thread_context != nullptr ? *thread_context : default_context(); }
+
+// the default context is configured by PONCI_PATH and PONRI_PATH
+static ponci_context &default_context() {
+	static auto &ctx = *[] {
+		const char *cgroup_env = std::getenv("PONCI_PATH");
+		const char *resctrl_env = std::getenv("PONRI_PATH");
+		return ponci_context_create(cgroup_env, resctrl_env);
+	}();
+
+	return ctx;
+}
+
+// NULL stands for the default context, as in ponci_context_use
+static ponci_context &context_or_default(ponci_context *ctx) { return ctx != nullptr ? *ctx : default_context(); }
+
+// check if path is located in a cgroup v2 file system
+static bool check_is_cgroup2(const std::string &path) {
+	struct statfs buf;
+	if (statfs(path.c_str(), &buf) != 0) {
+		throw std::system_error(errno, std::generic_category());
+	}
+#ifdef CGROUP2_SUPER_MAGIC
+	return buf.f_type == CGROUP2_SUPER_MAGIC;
+#else
+	return false;
+#endif
+}
+
+// re-reads the attribute of e, groups deleted outside of the library do not match
+static bool matches_current_value(const write_cache::entry &e) {
+	try {
+		switch (e.attr) {
+		case write_cache::attribute::cpus: {
+			const auto cpus = cgroup_get_cpus(e.group);
+			return write_cache::list_value(cpus.data(), cpus.size()) == e.value;
+		}
+		case write_cache::attribute::mems: {
+			const auto mems = cgroup_get_mems(e.group);
+			return write_cache::list_value(mems.data(), mems.size()) == e.value;
+		}
+		case write_cache::attribute::schemata: {
+			const auto schemata = resgroup_get_schemata(e.group);
+			const auto resource = schemata.find(e.resource);
+			if (resource == schemata.end()) return false;
+			const auto domain = resource->second.find(e.domain);
+			return domain != resource->second.end() && write_cache::schemata_value(domain->second) == e.value;
+		}
+		}
+	} catch (const std::exception &) {
+	}
+	return false;
+}
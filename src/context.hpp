@@ -0,0 +1,60 @@
+#ifndef ponci_context_internal
+#define ponci_context_internal
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "write_cache.hpp"
+
+// Definition of the opaque struct ponci_context of ponci.h. Not part of the public interface.
+
+struct resctrl_info;
+
+struct ponci_context {
+	// empty roots are discovered from /proc/self/mountinfo
+	ponci_context(const std::string &cgroup_root, const std::string &resctrl_root);
+	~ponci_context();
+
+	ponci_context(const ponci_context &) = delete;
+	ponci_context &operator=(const ponci_context &) = delete;
+
+	// the subsystems a cgroup is created in, either the cpuset and freezer hierarchies of cgroup v1 or a single
+	// unified hierarchy (named "")
+	const std::vector<std::string> &subsystems();
+
+	// returns the mount point of the hierarchy containing subsystem
+	std::string subsystem_root(const std::string &subsystem);
+
+	// returns true if the cgroup hierarchy is a cgroup v2 (unified) hierarchy
+	bool is_cgroup2();
+
+	// returns the directory resctrl is mounted to
+	std::string resctrl_mount() const;
+
+	const std::string cgroup_root;
+	const std::string resctrl_root;
+
+	// snapshot of the resctrl info directory, managed by ponri.cpp. It is read without locking, refreshes are
+	// serialized by info_mutex and keep the replaced (outdated) snapshots until the context is destroyed.
+	std::atomic<resctrl_info *> info{nullptr};
+	std::mutex info_mutex;
+	std::vector<resctrl_info *> retired_info;
+
+	// skips writes of cpus, mems and schemata entries that are already set, see ponci_context_set_write_cache
+	std::atomic<bool> cache_enabled{false};
+	write_cache cache;
+
+  private:
+	std::once_flag subsystems_flag;
+	std::vector<std::string> discovered_subsystems;
+
+	std::once_flag cgroup2_flag;
+	bool cgroup2 = false;
+};
+
+// returns the context of the calling thread
+ponci_context &current_context();
+
+#endif /* end of include guard: ponci_context_internal */
@@ -2,14 +2,26 @@
 #define fileIO_helper
 
 #include <bitset>
+#include <exception>
 #include <iomanip>
+#include <new>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 // size of the buffers used to read from file
 static constexpr std::size_t buf_size = 255;
@@ -34,6 +46,22 @@ template <> inline int string_to_T<int>(const std::string &s, std::size_t &done)
 template <std::size_t N>
 static inline void write_bitset_to_file(const std::string &filename, const std::bitset<N> &bits);
 
+static inline std::vector<size_t> string_to_list(const std::string &str);
+
+static inline size_t read_file_to_buffer(const char *filename, char *buf, size_t size, bool may_not_exist = false);
+static inline size_t read_file_to_vector(const char *filename, std::vector<char> &buf, bool may_not_exist = false);
+static inline int write_buffer_to_file_r(const char *filename, const char *buf, size_t len, bool append = false);
+static inline int write_int_to_file_r(const char *filename, long long val, bool append = false);
+template <typename T> static inline int write_array_to_file_r(const char *filename, const T *arr, size_t size);
+static inline int read_tids_from_file_r(const char *filename, std::vector<pid_t> &tids);
+static inline void throw_on_error(int err);
+template <typename F> static inline int no_throw(F f) noexcept;
+
+static inline uint64_t get_timestamp();
+static constexpr uint64_t hash_key(const char *str, uint64_t hash);
+struct stat_key;
+template <typename F> static inline void for_each_key_value(const char *buf, F f);
+
 template <typename T> static inline void write_vector_to_file(const std::string &filename, const std::vector<T> &vec) {
 	write_array_to_file(filename, &vec[0], vec.size());
 }
@@ -56,7 +84,7 @@ template <typename T> static inline void append_value_to_file(const std::string
 
 	FILE *f = fopen(filename.c_str(), "a+");
 	if (f == nullptr) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 	std::string str = std::to_string(val);
 
@@ -65,10 +93,10 @@ template <typename T> static inline void append_value_to_file(const std::string
 		auto err = errno;
 		fclose(f);
 
-		throw std::runtime_error(strerror(err));
+		throw std::system_error(err, std::generic_category());
 	}
 	if (fclose(f) != 0) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 }
 
@@ -96,7 +124,7 @@ template <> void write_value_to_file<const char *>(const std::string &filename,
 	FILE *file = fopen(filename.c_str(), "w+");
 
 	if (file == nullptr) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 
 	int status = fputs(val, file);
@@ -105,11 +133,11 @@ template <> void write_value_to_file<const char *>(const std::string &filename,
 		auto err = errno;
 		fclose(file);
 
-		throw std::runtime_error(strerror(err));
+		throw std::system_error(err, std::generic_category());
 	}
 
 	if (fclose(file) != 0) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 }
 
@@ -119,7 +147,7 @@ static inline std::string read_line_from_file(const std::string &filename) {
 	FILE *file = fopen(filename.c_str(), "r");
 
 	if (file == nullptr) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 
 	char temp[buf_size];
@@ -134,7 +162,7 @@ static inline std::string read_line_from_file(const std::string &filename) {
 	}
 
 	if (fclose(file) != 0) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 
 	return std::string(temp);
@@ -146,7 +174,7 @@ template <typename T> static inline std::vector<T> read_lines_from_file(const st
 	FILE *file = fopen(filename.c_str(), "r");
 
 	if (file == nullptr) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
 	}
 
 	std::vector<T> ret;
@@ -165,7 +193,241 @@ template <typename T> static inline std::vector<T> read_lines_from_file(const st
 	}
 
 	if (fclose(file) != 0) {
-		throw std::runtime_error(strerror(errno));
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	return ret;
+}
+
+// reads the whole file into buf (at most size - 1 bytes) and terminates it with 0
+// returns the number of bytes read, files that do not exist are empty if may_not_exist is set
+static inline size_t read_file_to_buffer(const char *filename, char *buf, size_t size, bool may_not_exist) {
+	assert(size > 0);
+
+	const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		if (may_not_exist && errno == ENOENT) {
+			buf[0] = '\0';
+			return 0;
+		}
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	size_t len = 0;
+	while (len < size - 1) {
+		const ssize_t ret = read(fd, buf + len, size - 1 - len);
+		if (ret == 0) break;
+		if (ret == -1) {
+			if (errno == EINTR) continue;
+			auto err = errno;
+			close(fd);
+			throw std::system_error(err, std::generic_category());
+		}
+		len += static_cast<size_t>(ret);
+	}
+	buf[len] = '\0';
+
+	if (close(fd) != 0) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	return len;
+}
+
+// same as read_file_to_buffer, but buf grows until the whole file fits. The memory of buf is reused by the next
+// call, so a loop sampling many files only allocates for the largest one.
+static inline size_t read_file_to_vector(const char *filename, std::vector<char> &buf, bool may_not_exist) {
+	if (buf.size() < 2) buf.resize(4096);
+
+	const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		if (may_not_exist && errno == ENOENT) {
+			buf[0] = '\0';
+			return 0;
+		}
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	size_t len = 0;
+	while (true) {
+		if (len == buf.size() - 1) {
+			try {
+				buf.resize(buf.size() * 2);
+			} catch (...) {
+				close(fd);
+				throw;
+			}
+		}
+		const ssize_t ret = read(fd, buf.data() + len, buf.size() - 1 - len);
+		if (ret == 0) break;
+		if (ret == -1) {
+			if (errno == EINTR) continue;
+			auto err = errno;
+			close(fd);
+			throw std::system_error(err, std::generic_category());
+		}
+		len += static_cast<size_t>(ret);
+	}
+	buf[len] = '\0';
+
+	if (close(fd) != 0) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	return len;
+}
+
+// no-throw counterpart of write_value_to_file / append_value_to_file, returns 0 or an errno code
+static inline int write_buffer_to_file_r(const char *filename, const char *buf, size_t len, bool append) {
+	const int fd = open(filename, O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0666);
+	if (fd == -1) return errno;
+
+	// cgroup and resctrl files expect a value in a single write
+	ssize_t ret;
+	do {
+		ret = write(fd, buf, len);
+	} while (ret == -1 && errno == EINTR);
+	int err = ret == -1 ? errno : (static_cast<size_t>(ret) != len ? EIO : 0);
+
+	if (close(fd) != 0 && err == 0) err = errno;
+	return err;
+}
+
+static inline int write_int_to_file_r(const char *filename, long long val, bool append) {
+	char buf[24];
+	const int len = snprintf(buf, sizeof(buf), "%lld", val);
+	return write_buffer_to_file_r(filename, buf, static_cast<size_t>(len), append);
+}
+
+template <typename T> static inline int write_array_to_file_r(const char *filename, const T *arr, size_t size) {
+	assert(size > 0);
+
+	std::string str;
+	for (size_t i = 0; i < size; ++i) {
+		str.append(std::to_string(arr[i]));
+		str.append(",");
+	}
+
+	return write_buffer_to_file_r(filename, str.c_str(), str.size());
+}
+
+// no-throw counterpart of read_lines_from_file<pid_t> for tasks / cgroup.procs files, returns 0 or an errno code
+static inline int read_tids_from_file_r(const char *filename, std::vector<pid_t> &tids) {
+	tids.clear();
+
+	const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return errno;
+
+	std::string content;
+	char buf[4096];
+	int err = 0;
+	while (true) {
+		const ssize_t ret = read(fd, buf, sizeof(buf));
+		if (ret == 0) break;
+		if (ret == -1) {
+			if (errno == EINTR) continue;
+			err = errno;
+			break;
+		}
+		content.append(buf, static_cast<size_t>(ret));
+	}
+	if (close(fd) != 0 && err == 0) err = errno;
+	if (err != 0) return err;
+
+	const char *pos = content.c_str();
+	while (*pos != '\0') {
+		char *end;
+		const long tid = strtol(pos, &end, 10);
+		if (end == pos) break;
+		tids.push_back(static_cast<pid_t>(tid));
+		pos = end;
+	}
+	return 0;
+}
+
+// turns the errno code returned by the body of a _r function into an exception
+static inline void throw_on_error(int err) {
+	if (err != 0) throw std::system_error(err, std::generic_category());
+}
+
+// runs the body of a _r function. A std::system_error (e.g. ENODEV if no hierarchy is mounted) returns its
+// code, out of memory returns ENOMEM, an invalid argument (std::logic_error) EINVAL and every other exception EIO.
+template <typename F> static inline int no_throw(F f) noexcept {
+	try {
+		return f();
+	} catch (const std::bad_alloc &) {
+		return ENOMEM;
+	} catch (const std::system_error &e) {
+		return e.code().category() == std::generic_category() && e.code().value() != 0 ? e.code().value() : EIO;
+	} catch (const std::logic_error &) {
+		return EINVAL;
+	} catch (const std::exception &) {
+		return EIO;
+	}
+}
+
+// returns CLOCK_MONOTONIC in nanoseconds, used to timestamp samples read from files
+static inline uint64_t get_timestamp() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// FNV-1a hash of a key in a statistic file, can be used as case label
+static constexpr uint64_t hash_key(const char *str, uint64_t hash = 14695981039346656037ull) {
+	return *str == '\0' ? hash : hash_key(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 1099511628211ull);
+}
+
+// a key of a statistic file. The hash selects the case label, comparing the string afterwards rules out a
+// collision with a key unknown to us.
+struct stat_key {
+	uint64_t hash;
+	const char *str;
+	size_t len;
+
+	bool operator==(const char *name) const { return strncmp(str, name, len) == 0 && name[len] == '\0'; }
+};
+
+// calls f(key, value) for every "key value" line in buf without allocating memory
+template <typename F> static inline void for_each_key_value(const char *buf, F f) {
+	while (*buf != '\0') {
+		uint64_t hash = hash_key("");
+		const char *key = buf;
+		while (*buf != ' ' && *buf != '\n' && *buf != '\0') {
+			hash = (hash ^ static_cast<unsigned char>(*buf)) * 1099511628211ull;
+			++buf;
+		}
+		const char *key_end = buf;
+		const bool has_key = buf != key;
+
+		char *end;
+		const uint64_t value = strtoull(buf, &end, 10);
+		buf = end;
+		while (*buf != '\n' && *buf != '\0') ++buf;
+		if (*buf == '\n') ++buf;
+
+		if (has_key) f(stat_key{hash, key, static_cast<size_t>(key_end - key)}, value);
+	}
+}
+
+// parses the kernel list format, e.g. "0-3,8,10-11"
+static inline std::vector<size_t> string_to_list(const std::string &str) {
+	std::vector<size_t> ret;
+
+	size_t pos = 0;
+	while (pos < str.size() && isdigit(str[pos]) != 0) {
+		std::size_t done = 0;
+		const size_t first = std::stoul(str.substr(pos), &done);
+		pos += done;
+
+		size_t last = first;
+		if (pos < str.size() && str[pos] == '-') {
+			last = std::stoul(str.substr(pos + 1), &done);
+			pos += done + 1;
+		}
+		for (size_t i = first; i <= last; ++i) ret.push_back(i);
+
+		if (pos < str.size() && str[pos] == ',') ++pos;
 	}
 
 	return ret;
@@ -0,0 +1,536 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "poncri/layout.hpp"
+
+#include "fileIO_helper.hpp"
+#include "ponci_internal.hpp"
+#include "ponri_internal.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// live values of the attributes of a cgroup, the defaults are the values of a new cgroup
+struct cgroup_state {
+	bool exists = false;
+	std::vector<size_t> cpus;
+	std::vector<size_t> mems;
+	int cpu_exclusive = 0;
+	int mem_hardwall = 0;
+	int memory_migrate = 0;
+	std::string freezer = "THAWED";
+};
+
+// a single step of ponci_apply
+struct change {
+	std::string description;
+	std::function<void()> apply;
+};
+
+using list_setter = void (*)(const char *, const size_t *, size_t);
+using flag_setter = void (*)(const char *, size_t);
+
+/////////////////////////////////////////////////////////////////
+// PROTOTYPES
+/////////////////////////////////////////////////////////////////
+static void parse_error(size_t line, const std::string &msg) __attribute__((noreturn));
+static std::string trim(const std::string &str);
+static std::vector<size_t> parse_list(const std::string &value, size_t line);
+static int parse_flag(const std::string &value, size_t line);
+static std::map<unsigned int, uint64_t> parse_schemata(const std::string &resource, const std::string &value,
+													   size_t line);
+
+static cgroup_state read_cgroup_state(const cgroup_layout &group);
+static void capture_cgroups(const std::string &parent, std::vector<cgroup_layout> &cgroups);
+static cgroup_layout capture_cgroup(const std::string &name);
+static std::vector<std::string> list_directories(const std::string &path);
+static bool directory_exists(const std::string &path);
+static size_t depth(const std::string &name);
+static std::string parent_of(const std::string &name);
+static int read_cpu_exclusive(const std::string &name);
+
+static std::vector<size_t> canonical(std::vector<size_t> list);
+static std::string list_to_string(const std::vector<size_t> &list);
+static std::string schemata_to_string(const resgroup_schemata &schemata);
+
+static void widen_list(std::vector<change> &changes, const std::string &name, const char *attr,
+					   const std::vector<size_t> &desired, std::vector<size_t> &current, list_setter set);
+static void narrow_list(std::vector<change> &changes, const std::string &name, const char *attr,
+						const std::vector<size_t> &desired, std::vector<size_t> &current, list_setter set);
+static void set_flag(std::vector<change> &changes, const std::string &name, const char *attr, int desired,
+					 int &current, flag_setter set);
+static void set_freezer(std::vector<change> &changes, const std::string &name, const std::string &desired,
+						std::string &current);
+
+/////////////////////////////////////////////////////////////////
+// EXPORTED FUNCTIONS
+/////////////////////////////////////////////////////////////////
+layout layout_parse(std::istream &in) {
+	enum class section { none, cgroup, resgroup };
+
+	layout res;
+	section current = section::none;
+
+	std::string raw;
+	size_t line = 0;
+	while (std::getline(in, raw)) {
+		++line;
+		const auto content = trim(raw.substr(0, raw.find('#')));
+		if (content.empty()) continue;
+
+		if (content.front() == '[') {
+			if (content.back() != ']') parse_error(line, "missing ]");
+			const auto header = trim(content.substr(1, content.size() - 2));
+			const auto space = header.find(' ');
+			const auto type = header.substr(0, space);
+			const auto name = space == std::string::npos ? std::string() : trim(header.substr(space + 1));
+			if (name.empty()) parse_error(line, "missing group name");
+
+			if (type == "cgroup") {
+				res.cgroups.emplace_back();
+				res.cgroups.back().name = name;
+				current = section::cgroup;
+			} else if (type == "resgroup") {
+				res.resgroups.emplace_back();
+				res.resgroups.back().name = name;
+				current = section::resgroup;
+			} else {
+				parse_error(line, "unknown section " + type);
+			}
+			continue;
+		}
+
+		const auto eq = content.find('=');
+		if (eq == std::string::npos) parse_error(line, "expected key = value");
+		const auto key = trim(content.substr(0, eq));
+		const auto value = trim(content.substr(eq + 1));
+
+		if (current == section::cgroup) {
+			auto &group = res.cgroups.back();
+			if (key == "cpus") {
+				group.cpus = parse_list(value, line);
+			} else if (key == "mems") {
+				group.mems = parse_list(value, line);
+			} else if (key == "cpu_exclusive") {
+				group.cpu_exclusive = parse_flag(value, line);
+			} else if (key == "mem_hardwall") {
+				group.mem_hardwall = parse_flag(value, line);
+			} else if (key == "memory_migrate") {
+				group.memory_migrate = parse_flag(value, line);
+			} else if (key == "freezer") {
+				if (value != "FROZEN" && value != "THAWED") parse_error(line, "freezer must be FROZEN or THAWED");
+				group.freezer = value;
+			} else {
+				parse_error(line, "unknown cgroup attribute " + key);
+			}
+		} else if (current == section::resgroup) {
+			res.resgroups.back().schemata[key] = parse_schemata(key, value, line);
+		} else {
+			parse_error(line, "attribute outside of a section");
+		}
+	}
+
+	return res;
+}
+
+layout layout_read(const std::string &filename) {
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		throw std::system_error(errno, std::generic_category());
+	}
+	return layout_parse(file);
+}
+
+layout layout_capture(const std::string &cgroup_root) {
+	layout res;
+	capture_cgroups(cgroup_root, res.cgroups);
+
+	// resctrl may not be mounted
+	const auto resctrl = resgroup_path("");
+	if (access((resctrl + "schemata").c_str(), F_OK) == 0) {
+		res.resgroups.push_back(resgroup_layout{"", resgroup_get_schemata("")});
+		for (const auto &name : list_directories(resctrl)) {
+			if (name == "info" || name == "mon_groups" || name == "mon_data") continue;
+			res.resgroups.push_back(resgroup_layout{name, resgroup_get_schemata(name)});
+		}
+	}
+
+	return res;
+}
+
+std::vector<std::string> ponci_apply(const layout &l, bool dry_run,
+									 const std::function<void(const std::string &)> &progress) {
+	std::map<std::string, cgroup_state> states;
+	for (const auto &group : l.cgroups) states[group.name] = read_cgroup_state(group);
+
+	// the cpus of an exclusive cpuset must not overlap with those of its siblings, so widening would fail.
+	// The flag is cleared on every group whose cpus change and on its exclusive siblings before any cpus
+	// are written and set again afterwards, siblings outside of the layout are restored the same way.
+	std::set<std::string> cleared_exclusive;
+	std::vector<cgroup_layout> siblings;
+	for (const auto &group : l.cgroups) {
+		const auto &state = states[group.name];
+		if (!state.exists || group.cpus.empty() || canonical(group.cpus) == state.cpus) continue;
+
+		const auto parent = parent_of(group.name);
+		auto cpuset = cgroup_path(parent.c_str());
+		replace_subsystem_in_path(cpuset, "cpuset");
+		for (const auto &child : list_directories(cpuset)) {
+			const auto name = parent.empty() ? child : parent + "/" + child;
+			if (cleared_exclusive.count(name) != 0 || read_cpu_exclusive(name) != 1) continue;
+
+			cleared_exclusive.insert(name);
+			if (states.count(name) == 0) {
+				siblings.emplace_back();
+				siblings.back().name = name;
+				siblings.back().cpu_exclusive = 1;
+				states[name] = read_cgroup_state(siblings.back());
+			}
+			states[name].cpu_exclusive = 1;
+		}
+	}
+
+	// parents before children
+	std::vector<const cgroup_layout *> top_down;
+	for (const auto &group : l.cgroups) top_down.push_back(&group);
+	for (const auto &group : siblings) top_down.push_back(&group);
+	std::stable_sort(top_down.begin(), top_down.end(), [](const cgroup_layout *a, const cgroup_layout *b) {
+		return depth(a->name) < depth(b->name);
+	});
+	const std::vector<const cgroup_layout *> bottom_up(top_down.rbegin(), top_down.rend());
+
+	std::vector<change> changes;
+
+	// a cpuset can only be exclusive if its parent is
+	for (const auto group : bottom_up) {
+		auto &state = states[group->name];
+		if (group->cpu_exclusive == 0 || cleared_exclusive.count(group->name) != 0) {
+			set_flag(changes, group->name, "cpu_exclusive", 0, state.cpu_exclusive, cgroup_set_cpus_exclusive);
+		}
+	}
+
+	// the cpus / mems of a child must be a subset of those of its parent
+	for (const auto group : top_down) {
+		auto &state = states[group->name];
+		if (!state.exists) {
+			const auto name = group->name;
+			changes.push_back(change{"create cgroup " + name, [name] { cgroup_create(name); }});
+			state.exists = true;
+		}
+
+		// memory_migrate must be set before mems change to take effect
+		set_flag(changes, group->name, "memory_migrate", group->memory_migrate, state.memory_migrate,
+				 cgroup_set_memory_migrate);
+		widen_list(changes, group->name, "cpus", group->cpus, state.cpus, cgroup_set_cpus);
+		widen_list(changes, group->name, "mems", group->mems, state.mems, cgroup_set_mems);
+	}
+	for (const auto group : bottom_up) {
+		auto &state = states[group->name];
+		narrow_list(changes, group->name, "cpus", group->cpus, state.cpus, cgroup_set_cpus);
+		narrow_list(changes, group->name, "mems", group->mems, state.mems, cgroup_set_mems);
+	}
+
+	for (const auto group : top_down) {
+		auto &state = states[group->name];
+		// groups cleared above keep their flag unless the layout clears it
+		if (group->cpu_exclusive == 1 || (group->cpu_exclusive == -1 && cleared_exclusive.count(group->name) != 0)) {
+			set_flag(changes, group->name, "cpu_exclusive", 1, state.cpu_exclusive, cgroup_set_cpus_exclusive);
+		}
+		set_flag(changes, group->name, "mem_hardwall", group->mem_hardwall, state.mem_hardwall,
+				 cgroup_set_mem_hardwall);
+	}
+
+	// freezing a parent freezes its children, so thaw top-down and freeze bottom-up
+	for (const auto group : top_down) {
+		if (group->freezer == "THAWED") set_freezer(changes, group->name, "THAWED", states[group->name].freezer);
+	}
+	for (const auto group : bottom_up) {
+		if (group->freezer == "FROZEN") set_freezer(changes, group->name, "FROZEN", states[group->name].freezer);
+	}
+
+	for (const auto &group : l.resgroups) {
+		const auto name = group.name;
+		resgroup_schemata current;
+		if (directory_exists(resgroup_path(name.c_str()))) {
+			current = resgroup_get_schemata(name);
+		} else {
+			changes.push_back(change{"create resgroup " + name, [name] { resgroup_create(name.c_str()); }});
+		}
+
+		const auto diff = resgroup_schemata_diff(current, group.schemata);
+		if (diff.empty()) continue;
+		changes.push_back(change{"set resgroup " + name + " schemata " + schemata_to_string(diff),
+								 [name, diff] { resgroup_write_schemata(name, diff); }});
+	}
+
+	std::vector<std::string> res;
+	for (const auto &c : changes) {
+		if (progress) progress(c.description);
+		if (!dry_run) {
+			try {
+				c.apply();
+			} catch (const std::runtime_error &e) {
+				throw std::runtime_error("Could not " + c.description + " after " + std::to_string(res.size()) +
+										 " changes: " + e.what());
+			}
+		}
+		res.push_back(c.description);
+	}
+	return res;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+static void parse_error(size_t line, const std::string &msg) {
+	throw std::runtime_error("Line " + std::to_string(line) + " of the layout: " + msg);
+}
+
+static std::string trim(const std::string &str) {
+	const auto first = str.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos) return std::string();
+	const auto last = str.find_last_not_of(" \t\r\n");
+	return str.substr(first, last - first + 1);
+}
+
+static std::vector<size_t> parse_list(const std::string &value, size_t line) {
+	if (value.empty() || value.find_first_not_of("0123456789,-") != std::string::npos) {
+		parse_error(line, "invalid list " + value);
+	}
+	return canonical(string_to_list(value));
+}
+
+static int parse_flag(const std::string &value, size_t line) {
+	if (value != "0" && value != "1") parse_error(line, "flags must be 0 or 1");
+	return value == "1" ? 1 : 0;
+}
+
+// value reads "<domain>=<value>;<domain>=<value>..."
+static std::map<unsigned int, uint64_t> parse_schemata(const std::string &resource, const std::string &value,
+													   size_t line) {
+	const int base = is_bandwidth_resource(resource) ? 10 : 16;
+
+	std::map<unsigned int, uint64_t> res;
+	const char *pos = value.c_str();
+	while (*pos != '\0') {
+		char *end;
+		const auto domain = static_cast<unsigned int>(strtoul(pos, &end, 10));
+		if (end == pos || *end != '=') parse_error(line, "invalid schemata " + value);
+
+		pos = end + 1;
+		res[domain] = strtoull(pos, &end, base);
+		if (end == pos || (*end != ';' && *end != '\0')) parse_error(line, "invalid schemata " + value);
+		pos = (*end == ';') ? end + 1 : end;
+	}
+
+	return res;
+}
+
+// reads the managed attributes of group
+static cgroup_state read_cgroup_state(const cgroup_layout &group) {
+	cgroup_state state;
+
+	auto cpuset = cgroup_path(group.name.c_str());
+	replace_subsystem_in_path(cpuset, "cpuset");
+	state.exists = directory_exists(cpuset);
+	if (!state.exists) return state;
+
+	if (!group.cpus.empty()) state.cpus = canonical(cgroup_get_cpus(group.name));
+	if (!group.mems.empty()) state.mems = canonical(cgroup_get_mems(group.name));
+
+	if (group.cpu_exclusive >= 0) state.cpu_exclusive = std::stoi(read_line_from_file(cpuset + "cpuset.cpu_exclusive"));
+	if (group.mem_hardwall >= 0) state.mem_hardwall = std::stoi(read_line_from_file(cpuset + "cpuset.mem_hardwall"));
+	if (group.memory_migrate >= 0) {
+		state.memory_migrate = std::stoi(read_line_from_file(cpuset + "cpuset.memory_migrate"));
+	}
+
+	if (!group.freezer.empty()) {
+		auto freezer = cgroup_path(group.name.c_str());
+		replace_subsystem_in_path(freezer, "freezer");
+		state.freezer = trim(read_line_from_file(freezer + "freezer.state"));
+	}
+
+	return state;
+}
+
+// appends the live state of parent (unless it is the root cgroup) and all cgroups below it
+static void capture_cgroups(const std::string &parent, std::vector<cgroup_layout> &cgroups) {
+	if (!parent.empty()) cgroups.push_back(capture_cgroup(parent));
+
+	auto cpuset = cgroup_path(parent.c_str());
+	replace_subsystem_in_path(cpuset, "cpuset");
+	for (const auto &child : list_directories(cpuset)) {
+		capture_cgroups(parent.empty() ? child : parent + "/" + child, cgroups);
+	}
+}
+
+static cgroup_layout capture_cgroup(const std::string &name) {
+	cgroup_layout group;
+	group.name = name;
+	group.cpus = canonical(cgroup_get_cpus(name));
+	group.mems = canonical(cgroup_get_mems(name));
+
+	auto cpuset = cgroup_path(name.c_str());
+	replace_subsystem_in_path(cpuset, "cpuset");
+	group.cpu_exclusive = std::stoi(read_line_from_file(cpuset + "cpuset.cpu_exclusive"));
+	group.mem_hardwall = std::stoi(read_line_from_file(cpuset + "cpuset.mem_hardwall"));
+	group.memory_migrate = std::stoi(read_line_from_file(cpuset + "cpuset.memory_migrate"));
+
+	// the freezer may not be mounted, FREEZING is captured as FROZEN
+	auto freezer = cgroup_path(name.c_str());
+	replace_subsystem_in_path(freezer, "freezer");
+	char buf[32];
+	if (read_file_to_buffer((freezer + "freezer.state").c_str(), buf, sizeof(buf), true) != 0) {
+		group.freezer = trim(buf) == "THAWED" ? "THAWED" : "FROZEN";
+	}
+
+	return group;
+}
+
+static std::vector<std::string> list_directories(const std::string &path) {
+	DIR *dir = opendir(path.c_str());
+	if (dir == nullptr) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	std::vector<std::string> res;
+	dirent *dent;
+	while ((dent = readdir(dir)) != nullptr) {
+		if (strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0) continue;
+		if (directory_exists(path + dent->d_name)) res.emplace_back(dent->d_name);
+	}
+	closedir(dir);
+
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+static bool directory_exists(const std::string &path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static size_t depth(const std::string &name) { return static_cast<size_t>(std::count(name.begin(), name.end(), '/')); }
+
+// returns the name of the parent cgroup, "" for top level cgroups
+static std::string parent_of(const std::string &name) {
+	const auto slash = name.rfind('/');
+	return slash == std::string::npos ? std::string() : name.substr(0, slash);
+}
+
+// cpuset.cpu_exclusive only exists on cgroup v1, it is 0 otherwise
+static int read_cpu_exclusive(const std::string &name) {
+	auto cpuset = cgroup_path(name.c_str());
+	replace_subsystem_in_path(cpuset, "cpuset");
+
+	char buf[32];
+	if (read_file_to_buffer((cpuset + "cpuset.cpu_exclusive").c_str(), buf, sizeof(buf), true) == 0) return 0;
+	return atoi(buf);
+}
+
+static std::vector<size_t> canonical(std::vector<size_t> list) {
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+	return list;
+}
+
+// formats a sorted list in the kernel list format, e.g. 0-3,8
+static std::string list_to_string(const std::vector<size_t> &list) {
+	std::string res;
+	for (size_t i = 0; i < list.size();) {
+		size_t j = i;
+		while (j + 1 < list.size() && list[j + 1] == list[j] + 1) ++j;
+
+		if (!res.empty()) res.append(",");
+		res.append(std::to_string(list[i]));
+		if (j != i) res.append("-" + std::to_string(list[j]));
+		i = j + 1;
+	}
+	return res;
+}
+
+static std::string schemata_to_string(const resgroup_schemata &schemata) {
+	std::string res;
+	for (const auto &resource : schemata) {
+		if (!res.empty()) res.append(" ");
+		res.append(resource.first + ":");
+
+		const bool is_hex = !is_bandwidth_resource(resource.first);
+		for (auto it = resource.second.begin(); it != resource.second.end(); ++it) {
+			char value[32];
+			snprintf(value, sizeof(value), is_hex ? "%" PRIx64 : "%" PRIu64, it->second);
+			if (it != resource.second.begin()) res.append(";");
+			res.append(std::to_string(it->first) + "=" + value);
+		}
+	}
+	return res;
+}
+
+// sets the list to the union of its current and desired value, unless it already contains the desired value
+static void widen_list(std::vector<change> &changes, const std::string &name, const char *attr,
+					   const std::vector<size_t> &desired, std::vector<size_t> &current, list_setter set) {
+	if (desired.empty() || std::includes(current.begin(), current.end(), desired.begin(), desired.end())) return;
+
+	std::vector<size_t> wide;
+	std::set_union(current.begin(), current.end(), desired.begin(), desired.end(), std::back_inserter(wide));
+
+	changes.push_back(change{"set cgroup " + name + " " + attr + " " + list_to_string(wide),
+							 [name, wide, set] { set(name.c_str(), wide.data(), wide.size()); }});
+	current = wide;
+}
+
+static void narrow_list(std::vector<change> &changes, const std::string &name, const char *attr,
+						const std::vector<size_t> &desired, std::vector<size_t> &current, list_setter set) {
+	if (desired.empty() || desired == current) return;
+
+	changes.push_back(change{"set cgroup " + name + " " + attr + " " + list_to_string(desired),
+							 [name, desired, set] { set(name.c_str(), desired.data(), desired.size()); }});
+	current = desired;
+}
+
+static void set_flag(std::vector<change> &changes, const std::string &name, const char *attr, int desired,
+					 int &current, flag_setter set) {
+	if (desired < 0 || desired == current) return;
+
+	changes.push_back(change{"set cgroup " + name + " " + attr + " " + std::to_string(desired),
+							 [name, desired, set] { set(name.c_str(), static_cast<size_t>(desired)); }});
+	current = desired;
+}
+
+static void set_freezer(std::vector<change> &changes, const std::string &name, const std::string &desired,
+						std::string &current) {
+	if (desired == current) return;
+
+	if (desired == "FROZEN") {
+		changes.push_back(change{"freeze cgroup " + name, [name] { cgroup_freeze(name.c_str()); }});
+	} else {
+		changes.push_back(change{"thaw cgroup " + name, [name] { cgroup_thaw(name.c_str()); }});
+	}
+	current = desired;
+}
@@ -0,0 +1,143 @@
+/**
+ * po     n  c       i
+ * poor mans cgroups interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "mountinfo.hpp"
+
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+
+/////////////////////////////////////////////////////////////////
+// PROTOTYPES
+/////////////////////////////////////////////////////////////////
+static void parse_mountinfo(mount_table &table);
+static void for_each_mount(
+	const std::function<void(const std::string &, const std::string &, const std::vector<std::string> &)> &f);
+static std::string strip_trailing_slashes(const std::string &path);
+static std::string unescape(const std::string &str);
+static std::vector<std::string> split(const std::string &str, char delim);
+
+/////////////////////////////////////////////////////////////////
+// EXPORTED FUNCTIONS
+/////////////////////////////////////////////////////////////////
+const mount_table &get_mount_table() {
+	static std::once_flag flag;
+	static mount_table *table = nullptr;
+
+	// an exception leaves the flag unset, so the next caller tries again
+	std::call_once(flag, [] {
+		auto res = new mount_table;
+		try {
+			parse_mountinfo(*res);
+		} catch (...) {
+			delete res;
+			throw;
+		}
+		table = res;
+	});
+
+	return *table;
+}
+
+std::vector<std::string> get_mount_options(const std::string &mount_point) {
+	const auto path = strip_trailing_slashes(mount_point);
+
+	// the last mount at a path hides the ones before
+	std::vector<std::string> res;
+	for_each_mount([&](const std::string &point, const std::string &, const std::vector<std::string> &options) {
+		if (point == path) res = options;
+	});
+	return res;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+static void parse_mountinfo(mount_table &table) {
+	// the first mount of a file system wins, later ones are usually bind mounts
+	for_each_mount([&](const std::string &mount_point, const std::string &fstype,
+					   const std::vector<std::string> &options) {
+		if (fstype == "cgroup") {
+			for (const auto &opt : options) {
+				if (opt == "rw" || opt == "ro") continue;
+				table.cgroup.emplace(opt, mount_point);
+			}
+		} else if (fstype == "cgroup2") {
+			if (table.cgroup2.empty()) table.cgroup2 = mount_point;
+		} else if (fstype == "resctrl") {
+			if (table.resctrl.empty()) table.resctrl = mount_point;
+		}
+	});
+}
+
+// calls f with the mount point, file system type and super block options of every mount. Every line reads
+// "<id> <parent> <major:minor> <root> <mount point> <options> [optional fields...] - <fstype> <source> <super options>"
+static void for_each_mount(
+	const std::function<void(const std::string &, const std::string &, const std::vector<std::string> &)> &f) {
+	std::ifstream file("/proc/self/mountinfo");
+	if (!file.is_open()) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		const auto fields = split(line, ' ');
+		if (fields.size() < 5) continue;
+
+		size_t sep = 5;
+		while (sep < fields.size() && fields[sep] != "-") ++sep;
+		if (sep + 3 >= fields.size()) continue;
+
+		f(unescape(fields[4]), fields[sep + 1], split(fields[sep + 3], ','));
+	}
+}
+
+static std::string strip_trailing_slashes(const std::string &path) {
+	const auto end = path.find_last_not_of('/');
+	return end == std::string::npos ? std::string("/") : path.substr(0, end + 1);
+}
+
+// the kernel escapes space, tab, newline and backslash as octal sequences
+static std::string unescape(const std::string &str) {
+	std::string res;
+	res.reserve(str.size());
+
+	for (size_t i = 0; i < str.size(); ++i) {
+		if (str[i] == '\\' && i + 3 < str.size() && str[i + 1] >= '0' && str[i + 1] <= '3') {
+			const int c = ((str[i + 1] - '0') << 6) | ((str[i + 2] - '0') << 3) | (str[i + 3] - '0');
+			res.push_back(static_cast<char>(c));
+			i += 3;
+		} else {
+			res.push_back(str[i]);
+		}
+	}
+
+	return res;
+}
+
+static std::vector<std::string> split(const std::string &str, char delim) {
+	std::vector<std::string> res;
+	std::istringstream stream(str);
+	std::string item;
+	while (std::getline(stream, item, delim)) {
+		if (!item.empty()) res.push_back(item);
+	}
+	return res;
+}
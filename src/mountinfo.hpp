@@ -0,0 +1,26 @@
+#ifndef mountinfo_helper
+#define mountinfo_helper
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Mount points of cgroup and resctrl file systems, shared by libponci and libponri. Not part of the public interface.
+
+struct mount_table {
+	// cgroup v1 controller (or name=... for named hierarchies) -> mount point, co-mounted controllers share one
+	std::map<std::string, std::string> cgroup;
+	// mount point of the cgroup v2 hierarchy, empty if not mounted
+	std::string cgroup2;
+	// mount point of resctrl, empty if not mounted
+	std::string resctrl;
+};
+
+// returns the mounts of the calling process, /proc/self/mountinfo is parsed on first use
+const mount_table &get_mount_table();
+
+// returns the super block options of the file system mounted at mount_point, empty if nothing is mounted there.
+// /proc/self/mountinfo is parsed on every call, so a remount is seen.
+std::vector<std::string> get_mount_options(const std::string &mount_point);
+
+#endif /* end of include guard: mountinfo_helper */
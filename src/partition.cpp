@@ -0,0 +1,94 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "poncri/partition.hpp"
+
+#include "fileIO_helper.hpp"
+#include "ponri_internal.hpp"
+#include "rollback_helper.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <syscall.h>
+#include <unistd.h>
+
+static void delete_partition(const std::string &name);
+
+partition::partition(const std::string &name, const std::vector<size_t> &cpus, const std::vector<size_t> &mems)
+	: context(ponci_context_current()), _name(name) {
+	cgroup_create(_name);
+	auto undo = make_rollback([this] { delete_partition(_name); });
+
+	resgroup_create(_name);
+	set_cpus(cpus);
+	set_mems(mems);
+
+	undo.commit();
+}
+
+partition::~partition() {
+	ponci_context_guard guard(context);
+	delete_partition(_name);
+}
+
+void partition::set_cpus(const std::vector<size_t> &cpus) {
+	ponci_context_guard guard(context);
+	cgroup_set_cpus(_name, cpus);
+	resgroup_set_cpus(_name, cpus);
+	_cpus = cpus;
+}
+
+void partition::set_mems(const std::vector<size_t> &mems) {
+	ponci_context_guard guard(context);
+	cgroup_set_mems(_name, mems);
+	_mems = mems;
+}
+
+void partition::set_schemata(const resgroup_schemata &schemata) {
+	ponci_context_guard guard(context);
+	resgroup_update_schemata(_name, schemata);
+}
+
+void partition::add_task(pid_t tid) {
+	ponci_context_guard guard(context);
+	cgroup_add_task(_name, tid);
+	// a task must not end up in only one half of the partition
+	const auto slash = _name.rfind('/');
+	const std::string parent = slash == std::string::npos ? std::string() : _name.substr(0, slash);
+	auto undo = make_rollback([&parent, tid] { cgroup_add_task_r(parent.c_str(), tid); });
+
+	resgroup_add_task(_name, tid);
+	undo.commit();
+}
+
+void partition::add_me() { add_task(static_cast<pid_t>(syscall(SYS_gettid))); }
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+// never throws, we clean up as much as possible. Also used if the constructor fails half way.
+static void delete_partition(const std::string &name) {
+	try {
+		for (const auto task : cgroup_get_tasks(name)) cgroup_add_task("", task);
+		cgroup_delete(name);
+	} catch (const std::runtime_error &) {
+	}
+
+	try {
+		const auto tasks = read_lines_from_file<pid_t>(resgroup_path(name.c_str()) + std::string("tasks"));
+		for (const auto task : tasks) resgroup_add_task("", task);
+		resgroup_delete(name);
+	} catch (const std::runtime_error &) {
+	}
+}
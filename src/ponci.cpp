@@ -11,12 +11,15 @@
 
 #include "ponci/ponci.hpp"
 
+#include "context.hpp"
 #include "fileIO_helper.hpp"
+#include "ponci_internal.hpp"
 
 #include <algorithm>
 #include <fstream>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include <cassert>
@@ -27,54 +30,60 @@
 #include <cstring>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <linux/sched.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <syscall.h>
 #include <unistd.h>
 
-// placeholder to be substituted by the names of a subsystem
+// placeholder to be substituted by the mount point of a subsystem
 static const auto &SUBSYSTEM_PLACEHOLDER = *new std::string("%SUBSYSTEM%");
 
-// list of subsystems, updated in constructor
-static std::vector<std::string> *subsystems;
-
 /////////////////////////////////////////////////////////////////
 // PROTOTYPES
 /////////////////////////////////////////////////////////////////
-static inline std::string cgroup_path(const char *name);
-
-static std::vector<int> get_tids_from_pid(int pid);
-
-static bool check_is_systemd();
-static void replace_subsystem_in_path(std::string &str, const std::string &to);
-
-static void _constructor() __attribute__((constructor));
+static int get_tids_from_pid(int pid, std::vector<int> &tids);
+
+// bodies shared by the _r and the throwing functions, they return the errno code of a failed write and throw
+// std::system_error if the hierarchy cannot be discovered
+static int create_cgroup(const char *name);
+static int delete_cgroup(const char *name);
+static int add_task_to_cgroup(const char *name, pid_t tid);
+static int write_cgroup_file(const char *name, const char *subsystem, const char *file, const char *val);
+static int write_cgroup_file(const char *name, const char *subsystem, const char *file, long long val);
+static int write_cgroup_list(const char *name, write_cache::attribute attr, const char *file, const size_t *list,
+							 size_t size);
+static int kill_cgroup(const char *name);
+static int spawn_in_cgroup(const char *name, char *const argv[], char *const envp[], pid_t *pid, int *pidfd);
+
+static int clone_into_cgroup(const std::string &path, char *const argv[], char *const envp[], int *pidfd,
+							 pid_t &child);
+static int fork_into_cgroup(const std::vector<std::string> &filenames, char *const argv[], char *const envp[],
+							pid_t &child);
+static void exec_child(int err_pipe, char *const argv[], char *const envp[]) __attribute__((noreturn));
+static void exit_child(int err_pipe) __attribute__((noreturn));
+static int wait_for_exec(int err_pipe, pid_t child);
 
 /////////////////////////////////////////////////////////////////
 // EXPORTED FUNCTIONS
 /////////////////////////////////////////////////////////////////
-void cgroup_create(const char *name) {
-	const auto cgp = cgroup_path(name);
-	for (const auto &sub : *subsystems) {
-		auto temp = cgp;
-		replace_subsystem_in_path(temp, sub);
-		const int err = mkdir(temp.c_str(), S_IRWXU | S_IRWXG);
+int cgroup_create_r(const char *name) {
+	return no_throw([name] { return create_cgroup(name); });
+}
 
-		if (err != 0 && errno != EEXIST) throw std::runtime_error(strerror(errno));
-	}
+void cgroup_create(const char *name) { throw_on_error(create_cgroup(name)); }
 
-	errno = 0;
+int cgroup_delete_r(const char *name) {
+	return no_throw([name] { return delete_cgroup(name); });
 }
 
-void cgroup_delete(const char *name) {
-	const auto cgp = cgroup_path(name);
-	for (const auto &sub : *subsystems) {
-		auto temp = cgp;
-		replace_subsystem_in_path(temp, sub);
-		const int err = rmdir(temp.c_str());
+void cgroup_delete(const char *name) { throw_on_error(delete_cgroup(name)); }
 
-		if (err != 0) throw std::runtime_error(strerror(errno));
-	}
+int cgroup_add_me_r(const char *name) {
+	auto me = static_cast<pid_t>(syscall(SYS_gettid));
+	return cgroup_add_task_r(name, me);
 }
 
 void cgroup_add_me(const char *name) {
@@ -82,106 +91,96 @@ void cgroup_add_me(const char *name) {
 	cgroup_add_task(name, me);
 }
 
-void cgroup_add_task(const char *name, const pid_t tid) {
-	const auto cgp = cgroup_path(name);
-	for (const auto &sub : *subsystems) {
-		auto temp = cgp;
-		replace_subsystem_in_path(temp, sub);
+int cgroup_add_task_r(const char *name, const pid_t tid) {
+	return no_throw([name, tid] { return add_task_to_cgroup(name, tid); });
+}
 
-		temp += std::string("tasks");
-		append_value_to_file(temp, tid);
-	}
+void cgroup_add_task(const char *name, const pid_t tid) { throw_on_error(add_task_to_cgroup(name, tid)); }
+
+int cgroup_set_cpus_r(const char *name, const size_t *cpus, size_t size) {
+	return no_throw([=] { return write_cgroup_list(name, write_cache::attribute::cpus, "cpuset.cpus", cpus, size); });
 }
 
 void cgroup_set_cpus(const char *name, const size_t *cpus, size_t size) {
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.cpus");
-
-	write_array_to_file(filename, cpus, size);
+	throw_on_error(write_cgroup_list(name, write_cache::attribute::cpus, "cpuset.cpus", cpus, size));
 }
 
 void cgroup_set_cpus(const std::string &name, const std::vector<unsigned char> &cpus) {
-	auto cgp = cgroup_path(name.c_str());
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.cpus");
+	const std::vector<size_t> list(cpus.begin(), cpus.end());
+	cgroup_set_cpus(name.c_str(), list.data(), list.size());
+}
 
-	write_vector_to_file(filename, cpus);
+int cgroup_set_mems_r(const char *name, const size_t *mems, size_t size) {
+	return no_throw([=] { return write_cgroup_list(name, write_cache::attribute::mems, "cpuset.mems", mems, size); });
 }
 
 void cgroup_set_mems(const char *name, const size_t *mems, size_t size) {
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.mems");
-
-	write_array_to_file(filename, mems, size);
+	throw_on_error(write_cgroup_list(name, write_cache::attribute::mems, "cpuset.mems", mems, size));
 }
 
 void cgroup_set_mems(const std::string &name, const std::vector<unsigned char> &mems) {
-	auto cgp = cgroup_path(name.c_str());
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.mems");
+	const std::vector<size_t> list(mems.begin(), mems.end());
+	cgroup_set_mems(name.c_str(), list.data(), list.size());
+}
 
-	write_vector_to_file(filename, mems);
+int cgroup_set_memory_migrate_r(const char *name, size_t flag) {
+	assert(flag == 0 || flag == 1);
+	return no_throw([=] { return write_cgroup_file(name, "cpuset", "cpuset.memory_migrate", flag); });
 }
 
 void cgroup_set_memory_migrate(const char *name, size_t flag) {
 	assert(flag == 0 || flag == 1);
+	throw_on_error(write_cgroup_file(name, "cpuset", "cpuset.memory_migrate", flag));
+}
 
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.memory_migrate");
-
-	write_value_to_file(filename, flag);
+int cgroup_set_cpus_exclusive_r(const char *name, size_t flag) {
+	assert(flag == 0 || flag == 1);
+	return no_throw([=] { return write_cgroup_file(name, "cpuset", "cpuset.cpu_exclusive", flag); });
 }
 
 void cgroup_set_cpus_exclusive(const char *name, size_t flag) {
 	assert(flag == 0 || flag == 1);
+	throw_on_error(write_cgroup_file(name, "cpuset", "cpuset.cpu_exclusive", flag));
+}
 
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.cpu_exclusive");
-
-	write_value_to_file(filename, flag);
+int cgroup_set_mem_hardwall_r(const char *name, size_t flag) {
+	assert(flag == 0 || flag == 1);
+	return no_throw([=] { return write_cgroup_file(name, "cpuset", "cpuset.mem_hardwall", flag); });
 }
 
 void cgroup_set_mem_hardwall(const char *name, size_t flag) {
 	assert(flag == 0 || flag == 1);
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.mem_hardwall");
+	throw_on_error(write_cgroup_file(name, "cpuset", "cpuset.mem_hardwall", flag));
+}
 
-	write_value_to_file(filename, flag);
+int cgroup_set_scheduling_domain_r(const char *name, int flag) {
+	assert(flag >= -1 && flag <= 5);
+	return no_throw([=] { return write_cgroup_file(name, "cpuset", "cpuset.sched_relax_domain_level", flag); });
 }
 
 void cgroup_set_scheduling_domain(const char *name, int flag) {
 	assert(flag >= -1 && flag <= 5);
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "cpuset");
-	std::string filename = cgp + std::string("cpuset.sched_relax_domain_level");
+	throw_on_error(write_cgroup_file(name, "cpuset", "cpuset.sched_relax_domain_level", flag));
+}
 
-	write_value_to_file(filename, flag);
+int cgroup_freeze_r(const char *name) {
+	// never freeze top level cgroup
+	assert(strcmp(name, "") != 0);
+	return no_throw([name] { return write_cgroup_file(name, "freezer", "freezer.state", "FROZEN"); });
 }
 
 void cgroup_freeze(const char *name) {
 	// never freeze top level cgroup
 	assert(strcmp(name, "") != 0);
-
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "freezer");
-	std::string filename = cgp + std::string("freezer.state");
-
-	write_value_to_file(filename, "FROZEN");
+	throw_on_error(write_cgroup_file(name, "freezer", "freezer.state", "FROZEN"));
 }
 
-void cgroup_thaw(const char *name) {
-	auto cgp = cgroup_path(name);
-	replace_subsystem_in_path(cgp, "freezer");
-	std::string filename = cgp + std::string("freezer.state");
-
-	write_value_to_file(filename, "THAWED");
+int cgroup_thaw_r(const char *name) {
+	return no_throw([name] { return write_cgroup_file(name, "freezer", "freezer.state", "THAWED"); });
 }
 
+void cgroup_thaw(const char *name) { throw_on_error(write_cgroup_file(name, "freezer", "freezer.state", "THAWED")); }
+
 void cgroup_wait_frozen(const char *name) {
 	// never freeze top level cgroup
 	assert(strcmp(name, "") != 0);
@@ -207,45 +206,56 @@ void cgroup_wait_thawed(const char *name) {
 	}
 }
 
-void cgroup_kill(const char *name) {
-	auto tids = get_tids_from_pid(getpid());
+void cgroup_kill(const char *name) { throw_on_error(kill_cgroup(name)); }
 
-	auto cgp = cgroup_path(name);
+int cgroup_kill_r(const char *name) {
+	return no_throw([name] { return kill_cgroup(name); });
+}
+
+std::vector<size_t> cgroup_get_cpus(const std::string &name) {
+	auto cgp = cgroup_path(name.c_str());
 	replace_subsystem_in_path(cgp, "cpuset");
 
-	// get all pids
-	std::vector<__pid_t> pids = read_lines_from_file<__pid_t>(cgp + std::string("tasks"));
+	return string_to_list(read_line_from_file(cgp + std::string("cpuset.cpus")));
+}
 
-	// send kill
-	for (__pid_t pid : pids) {
-		if (std::find(tids.begin(), tids.end(), pid) != tids.end()) {
-			// pid in tids -> we should not kill ourself :)
-		} else {
-			// pid not in tids
-			if (kill(pid, SIGTERM) != 0) {
-				throw std::runtime_error(strerror(errno));
-			}
-		}
-	}
+std::vector<size_t> cgroup_get_mems(const std::string &name) {
+	auto cgp = cgroup_path(name.c_str());
+	replace_subsystem_in_path(cgp, "cpuset");
 
-	// wait until tasks empty
-	while (!pids.empty()) {
-		pids = read_lines_from_file<int>(cgp + std::string("tasks"));
-	}
+	return string_to_list(read_line_from_file(cgp + std::string("cpuset.mems")));
+}
+
+std::vector<pid_t> cgroup_get_tasks(const std::string &name) {
+	auto cgp = cgroup_path(name.c_str());
+	replace_subsystem_in_path(cgp, current_context().subsystems().front());
 
-	cgroup_delete(name);
+	return read_lines_from_file<pid_t>(cgp + std::string("tasks"));
+}
+
+int cgroup_spawn(const char *name, char *const argv[], char *const envp[], pid_t *pid) {
+	int pidfd = -1;
+	throw_on_error(spawn_in_cgroup(name, argv, envp, pid, &pidfd));
+
+	errno = 0;
+	return pidfd;
+}
+
+int cgroup_spawn_r(const char *name, char *const argv[], char *const envp[], pid_t *pid, int *pidfd) {
+	return no_throw([=] {
+		int fd = -1;
+		const int err = spawn_in_cgroup(name, argv, envp, pid, &fd);
+		if (pidfd != nullptr) *pidfd = fd;
+		return err;
+	});
 }
 
 /////////////////////////////////////////////////////////////////
 // INTERNAL FUNCTIONS
 /////////////////////////////////////////////////////////////////
 
-static inline std::string cgroup_path(const char *name) {
-	static const char *env = std::getenv("PONCI_PATH");
-
-	std::string res(env != nullptr ? std::string(env) : std::string("/sys/fs/cgroup/"));
-
-	res.append(SUBSYSTEM_PLACEHOLDER);
+std::string cgroup_path(const char *name) {
+	std::string res(SUBSYSTEM_PLACEHOLDER);
 	res.append("/");
 
 	if (strcmp(name, "") != 0) {
@@ -389,16 +399,156 @@ template <> unsigned long string_to_T<unsigned long>(const std::string &s, std::
 }
 #endif
 
-static std::vector<int> get_tids_from_pid(const int pid) {
+static int create_cgroup(const char *name) {
+	const auto cgp = cgroup_path(name);
+	for (const auto &sub : current_context().subsystems()) {
+		auto temp = cgp;
+		replace_subsystem_in_path(temp, sub);
+		const int err = mkdir(temp.c_str(), S_IRWXU | S_IRWXG);
+
+		if (err != 0 && errno != EEXIST) return errno;
+	}
+
+	errno = 0;
+	return 0;
+}
+
+static int delete_cgroup(const char *name) {
+	const auto cgp = cgroup_path(name);
+	for (const auto &sub : current_context().subsystems()) {
+		auto temp = cgp;
+		replace_subsystem_in_path(temp, sub);
+		const int err = rmdir(temp.c_str());
+
+		if (err != 0) return errno;
+	}
+
+	// a new cgroup of the same name starts with the values of its parent
+	current_context().cache.erase_group(name, false);
+	return 0;
+}
+
+static int add_task_to_cgroup(const char *name, const pid_t tid) {
+	const auto cgp = cgroup_path(name);
+	for (const auto &sub : current_context().subsystems()) {
+		auto temp = cgp;
+		replace_subsystem_in_path(temp, sub);
+
+		temp += std::string("tasks");
+		const int err = write_int_to_file_r(temp.c_str(), tid, true);
+		if (err != 0) return err;
+	}
+	return 0;
+}
+
+// writes val to file of the cpuset / freezer subsystem of cgroup name
+static int write_cgroup_file(const char *name, const char *subsystem, const char *file, const char *val) {
+	auto cgp = cgroup_path(name);
+	replace_subsystem_in_path(cgp, subsystem);
+	const std::string filename = cgp + std::string(file);
+
+	return write_buffer_to_file_r(filename.c_str(), val, strlen(val));
+}
+
+static int write_cgroup_file(const char *name, const char *subsystem, const char *file, long long val) {
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%lld", val);
+	return write_cgroup_file(name, subsystem, file, buf);
+}
+
+// writes a cpu / memory node list, unless the write cache knows that it is already set
+static int write_cgroup_list(const char *name, write_cache::attribute attr, const char *file, const size_t *list,
+							 size_t size) {
+	auto cgp = cgroup_path(name);
+	replace_subsystem_in_path(cgp, "cpuset");
+	const std::string filename = cgp + std::string(file);
+
+	auto &ctx = current_context();
+	if (!ctx.cache_enabled.load(std::memory_order_relaxed)) return write_array_to_file_r(filename.c_str(), list, size);
+
+	const write_cache::entry entry{attr, name, std::string(), 0, write_cache::list_value(list, size)};
+	return ctx.cache.write({entry}, [&filename, list, size](const std::vector<write_cache::entry> &) {
+		return write_array_to_file_r(filename.c_str(), list, size);
+	});
+}
+
+// sends SIGTERM to all tasks of the cgroup except for our own threads, waits until they are gone and deletes it
+static int kill_cgroup(const char *name) {
+	std::vector<int> tids;
+	int err = get_tids_from_pid(getpid(), tids);
+	if (err != 0) return err;
+
+	auto cgp = cgroup_path(name);
+	replace_subsystem_in_path(cgp, "cpuset");
+	const std::string filename = cgp + std::string("tasks");
+
+	std::vector<pid_t> pids;
+	err = read_tids_from_file_r(filename.c_str(), pids);
+	if (err != 0) return err;
+
+	for (const pid_t pid : pids) {
+		// we should not kill ourself :)
+		if (std::find(tids.begin(), tids.end(), pid) != tids.end()) continue;
+		if (kill(pid, SIGTERM) != 0) return errno;
+	}
+
+	// wait until tasks empty
+	while (!pids.empty()) {
+		err = read_tids_from_file_r(filename.c_str(), pids);
+		if (err != 0) return err;
+	}
+
+	return delete_cgroup(name);
+}
+
+// the pidfd is -1 if the kernel does not support pidfds
+static int spawn_in_cgroup(const char *name, char *const argv[], char *const envp[], pid_t *pid, int *pidfd) {
+	if (argv == nullptr || argv[0] == nullptr) return EINVAL;
+
+	const auto cgp = cgroup_path(name);
+	auto temp = cgp;
+	replace_subsystem_in_path(temp, current_context().subsystems().front());
+	const bool is_cgroup2 = cgroup_is_v2();
+
+	*pidfd = -1;
+	pid_t child = -1;
+	if (is_cgroup2) {
+		const int err = clone_into_cgroup(temp, argv, envp, pidfd, child);
+		if (err != 0) return err;
+	}
+
+	if (child == -1) {
+		// all filenames must be computed before forking, the child must not allocate memory
+		std::vector<std::string> filenames;
+		if (is_cgroup2) {
+			filenames.push_back(temp + std::string("cgroup.procs"));
+		} else {
+			for (const auto &sub : current_context().subsystems()) {
+				temp = cgp;
+				replace_subsystem_in_path(temp, sub);
+				filenames.push_back(temp + std::string("tasks"));
+			}
+		}
+
+		const int err = fork_into_cgroup(filenames, argv, envp, child);
+		if (err != 0) return err;
+#ifdef SYS_pidfd_open
+		*pidfd = static_cast<int>(syscall(SYS_pidfd_open, child, 0));
+#endif
+	}
+
+	if (pid != nullptr) *pid = child;
+	return 0;
+}
+
+static int get_tids_from_pid(const int pid, std::vector<int> &tids) {
 	std::string path("/proc/" + std::to_string(pid) + "/task/");
 	dirent *dent;
 	DIR *srcdir = opendir(path.c_str());
 
-	if (srcdir == nullptr) {
-		throw std::runtime_error(strerror(errno));
-	}
+	if (srcdir == nullptr) return errno;
 
-	std::vector<int> ret;
+	tids.clear();
 
 	while ((dent = readdir(srcdir)) != nullptr) {
 		struct stat st;
@@ -410,60 +560,124 @@ static std::vector<int> get_tids_from_pid(const int pid) {
 		}
 
 		if (S_ISDIR(st.st_mode)) {
-			std::size_t i;
-			ret.push_back(string_to_T<int>(std::string(dent->d_name), i));
+			tids.push_back(static_cast<int>(strtol(dent->d_name, nullptr, 10)));
 		}
 	}
 	closedir(srcdir);
-	return ret;
+	return 0;
 }
 
-static void replace_subsystem_in_path(std::string &str, const std::string &to) {
+void replace_subsystem_in_path(std::string &str, const std::string &to) {
 	size_t start_pos = str.find(SUBSYSTEM_PLACEHOLDER);
 	assert(start_pos != std::string::npos);
-	str.replace(start_pos, SUBSYSTEM_PLACEHOLDER.length(), to);
+	str.replace(start_pos, SUBSYSTEM_PLACEHOLDER.length(), current_context().subsystem_root(to));
 }
 
-// check if the system is using systemd
-static bool check_is_systemd() {
-	bool ret = false;
+bool cgroup_is_v2() { return current_context().is_cgroup2(); }
 
-	// read /etc/mtab and check if it contains "cgroup /sys/fs/cgroup/systemd"
-	FILE *file = fopen("/etc/mtab", "r");
+// starts the child inside the cgroup at path with clone3(CLONE_INTO_CGROUP)
+// child is -1 if the kernel does not support it
+static int clone_into_cgroup(const std::string &path, char *const argv[], char *const envp[], int *pidfd,
+							 pid_t &child) {
+	child = -1;
+#if defined(SYS_clone3) && defined(CLONE_INTO_CGROUP)
+	const int cgroup_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (cgroup_fd == -1) return errno;
 
-	if (file == nullptr) {
-		throw std::runtime_error(strerror(errno));
+	int err_pipe[2];
+	if (pipe2(err_pipe, O_CLOEXEC) != 0) {
+		auto err = errno;
+		close(cgroup_fd);
+		return err;
 	}
 
-	char temp[buf_size];
-	while (true) {
-		if (fgets(temp, buf_size, file) == nullptr && (feof(file) == 0)) {
-			// something is wrong. let's try to close the file and go home
-			fclose(file);
-			throw std::runtime_error("Error while reading file in libponci. Buffer to small?");
-		}
-		if (feof(file) != 0) break;
-		if (std::string(temp).find("cgroup /sys/fs/cgroup/systemd") != std::string::npos) {
-			ret = true;
-			break;
-		}
+	struct clone_args args;
+	memset(&args, 0, sizeof(args));
+	args.flags = CLONE_PIDFD | CLONE_INTO_CGROUP;
+	args.pidfd = reinterpret_cast<uint64_t>(pidfd);
+	args.exit_signal = SIGCHLD;
+	args.cgroup = static_cast<uint64_t>(cgroup_fd);
+
+	child = static_cast<pid_t>(syscall(SYS_clone3, &args, sizeof(args)));
+	if (child == 0) {
+		exec_child(err_pipe[1], argv, envp);
 	}
 
-	if (fclose(file) != 0) {
-		throw std::runtime_error(strerror(errno));
+	auto err = errno;
+	close(cgroup_fd);
+	close(err_pipe[1]);
+
+	if (child == -1) {
+		close(err_pipe[0]);
+		// kernel too old, let the caller fall back to fork
+		if (err == ENOSYS || err == E2BIG || err == EINVAL) return 0;
+		return err;
 	}
 
-	return ret;
+	return wait_for_exec(err_pipe[0], child);
+#else
+	(void)path;
+	(void)argv;
+	(void)envp;
+	(void)pidfd;
+	return 0;
+#endif
 }
 
-void _constructor() {
-	bool is_systemd = check_is_systemd();
+// forks and moves the child into the cgroup by writing to all filenames before calling exec
+static int fork_into_cgroup(const std::vector<std::string> &filenames, char *const argv[], char *const envp[],
+							pid_t &child) {
+	int err_pipe[2];
+	if (pipe2(err_pipe, O_CLOEXEC) != 0) return errno;
+
+	child = fork();
+	if (child == 0) {
+		// only async-signal-safe functions from here on
+		for (const auto &filename : filenames) {
+			const int fd = open(filename.c_str(), O_WRONLY | O_CLOEXEC);
+			// writing 0 moves the writing task
+			if (fd == -1 || write(fd, "0", 1) != 1) exit_child(err_pipe[1]);
+			close(fd);
+		}
+		exec_child(err_pipe[1], argv, envp);
+	}
+
+	auto err = errno;
+	close(err_pipe[1]);
 
-	subsystems = new std::vector<std::string>;
-	if (is_systemd) {
-		subsystems->emplace_back("cpuset");
-		subsystems->emplace_back("freezer");
-	} else {
-		subsystems->emplace_back("");
+	if (child == -1) {
+		close(err_pipe[0]);
+		return err;
 	}
+
+	return wait_for_exec(err_pipe[0], child);
+}
+
+// calls exec and reports the error via err_pipe if it fails
+static void exec_child(int err_pipe, char *const argv[], char *const envp[]) {
+	execve(argv[0], argv, envp);
+	exit_child(err_pipe);
+}
+
+// reports errno to the parent and terminates the child
+static void exit_child(int err_pipe) {
+	const int err = errno;
+	const auto len = write(err_pipe, &err, sizeof(err));
+	(void)len;
+	_exit(127);
+}
+
+// err_pipe is closed on a successful exec, otherwise it contains the errno of the child which is returned
+static int wait_for_exec(int err_pipe, pid_t child) {
+	int err = 0;
+	ssize_t len;
+	do {
+		len = read(err_pipe, &err, sizeof(err));
+	} while (len == -1 && errno == EINTR);
+	close(err_pipe);
+
+	if (len != sizeof(err)) return 0;
+
+	waitpid(child, nullptr, 0);
+	return err;
 }
@@ -0,0 +1,47 @@
+/**
+ * Applies a layout file (see poncri/layout.hpp) to the cgroups and ressource groups of the node.
+ *
+ *   ponci_apply [-n] <layout>
+ *
+ * Prints every change before it is made, -n only prints the changes without applying them.
+ * If a change fails, the changes printed before it are applied, the node is left partially
+ * changed.
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "poncri/layout.hpp"
+
+int main(int argc, char const *argv[]) {
+	bool dry_run = false;
+	int arg = 1;
+	if (arg < argc && strcmp(argv[arg], "-n") == 0) {
+		dry_run = true;
+		++arg;
+	}
+
+	if (arg + 1 != argc) {
+		std::cerr << "usage: " << argv[0] << " [-n] <layout>" << std::endl;
+		return 2;
+	}
+
+	// every change is printed before it is applied, so a failure shows what was already changed
+	try {
+		const auto print = [](const std::string &change) { std::cout << change << std::endl; };
+		ponci_apply(layout_read(argv[arg]), dry_run, print);
+	} catch (const std::exception &e) {
+		std::cerr << argv[0] << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
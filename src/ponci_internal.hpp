@@ -0,0 +1,17 @@
+#ifndef ponci_internal
+#define ponci_internal
+
+#include <string>
+
+// Functions shared by the libponci translation units. Not part of the public interface.
+
+// returns the path of cgroup name with a placeholder for the subsystem
+std::string cgroup_path(const char *name);
+
+// replaces the subsystem placeholder in str with the mount point of the hierarchy containing subsystem
+void replace_subsystem_in_path(std::string &str, const std::string &to);
+
+// returns true if the cgroup hierarchy is a cgroup v2 (unified) hierarchy
+bool cgroup_is_v2();
+
+#endif /* end of include guard: ponci_internal */
@@ -0,0 +1,257 @@
+/**
+ * LD_PRELOAD shim placing every thread created with pthread_create into a cgroup.
+ *
+ * Configuration via environment variables:
+ *   PONCI_PRELOAD_CGROUPS  comma separated list of (existing) cgroups,
+ *                          for the name policy a list of threadname=cgroup pairs
+ *   PONCI_PRELOAD_POLICY   rr    (default): thread i is added to cgroup i % n
+ *                          order          : thread i is added to cgroup i, threads
+ *                                           i >= n are not touched
+ *                          name           : threads are added to the cgroup of the
+ *                                           first matching thread name prefix when
+ *                                           pthread_setname_np names them. Every
+ *                                           entry needs a non-empty prefix. A new
+ *                                           thread keeps the cgroup of its creator
+ *                                           until it is named.
+ *
+ * Example:
+ *   PONCI_PRELOAD_CGROUPS=core0,core1 LD_PRELOAD=libponci_preload.so ./app
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "ponci/ponci.hpp"
+
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <syscall.h>
+#include <unistd.h>
+
+enum class placement_policy { round_robin, order, name };
+
+struct preload_config {
+	placement_policy policy = placement_policy::round_robin;
+	// (thread name prefix, cgroup), the prefix is empty for rr and order
+	std::vector<std::pair<std::string, std::string>> cgroups;
+};
+
+struct start_args {
+	void *(*start_routine)(void *);
+	void *arg;
+	size_t number;
+};
+
+// threads started through our pthread_create, pthread_setname_np needs their tid to move a thread other than
+// the caller. A thread named before it registered itself is placed by the name in pending on registration.
+struct thread_registry {
+	std::mutex mutex;
+	std::map<pthread_t, pid_t> tids;
+	std::map<pthread_t, std::string> pending;
+};
+
+using pthread_create_t = int (*)(pthread_t *, const pthread_attr_t *, void *(*)(void *), void *);
+using pthread_setname_np_t = int (*)(pthread_t, const char *);
+
+/////////////////////////////////////////////////////////////////
+// PROTOTYPES
+/////////////////////////////////////////////////////////////////
+static const preload_config &config();
+static thread_registry &registry();
+static const char *select_cgroup_by_name(const char *thread_name);
+static void place_thread(const char *cgroup, pid_t tid);
+static void *start_trampoline(void *p);
+static void *run_named_thread(const start_args &args);
+
+template <typename T> static T next_symbol(const char *symbol);
+
+/////////////////////////////////////////////////////////////////
+// INTERPOSED FUNCTIONS
+/////////////////////////////////////////////////////////////////
+extern "C" int pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *),
+							  void *arg) {
+	static const auto real_pthread_create = next_symbol<pthread_create_t>("pthread_create");
+	static std::atomic<size_t> counter(0);
+
+	if (config().cgroups.empty()) return real_pthread_create(thread, attr, start_routine, arg);
+
+	auto args = new start_args{start_routine, arg, counter++};
+	const int ret = real_pthread_create(thread, attr, start_trampoline, args);
+	if (ret != 0) delete args;
+	return ret;
+}
+
+extern "C" int pthread_setname_np(pthread_t thread, const char *name) {
+	static const auto real_pthread_setname_np = next_symbol<pthread_setname_np_t>("pthread_setname_np");
+
+	const int ret = real_pthread_setname_np(thread, name);
+	if (ret != 0 || config().policy != placement_policy::name) return ret;
+
+	const char *cgroup = select_cgroup_by_name(name);
+	if (pthread_equal(thread, pthread_self()) != 0) {
+		place_thread(cgroup, static_cast<pid_t>(syscall(SYS_gettid)));
+		return ret;
+	}
+
+	// there is no portable pthread_t -> tid mapping, only threads started by us can be moved
+	pid_t tid = 0;
+	{
+		auto &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		const auto it = reg.tids.find(thread);
+		if (it != reg.tids.end()) {
+			tid = it->second;
+		} else if (cgroup != nullptr) {
+			reg.pending[thread] = cgroup;
+		} else {
+			reg.pending.erase(thread);
+		}
+	}
+	if (tid != 0) place_thread(cgroup, tid);
+
+	return ret;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+static void *start_trampoline(void *p) {
+	const auto args = *static_cast<start_args *>(p);
+	delete static_cast<start_args *>(p);
+
+	const auto &conf = config();
+	const auto me = static_cast<pid_t>(syscall(SYS_gettid));
+	switch (conf.policy) {
+	case placement_policy::round_robin:
+		place_thread(conf.cgroups[args.number % conf.cgroups.size()].second.c_str(), me);
+		break;
+	case placement_policy::order:
+		if (args.number < conf.cgroups.size()) place_thread(conf.cgroups[args.number].second.c_str(), me);
+		break;
+	case placement_policy::name:
+		// a new thread has the name of its creator, it is placed once it gets its own name
+		return run_named_thread(args);
+	}
+
+	return args.start_routine(args.arg);
+}
+
+static void *run_named_thread(const start_args &args) {
+	auto &reg = registry();
+	const auto self = pthread_self();
+	const auto me = static_cast<pid_t>(syscall(SYS_gettid));
+
+	std::string cgroup;
+	{
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		// overwrites the entry of an exited thread with the same pthread_t
+		reg.tids[self] = me;
+		const auto it = reg.pending.find(self);
+		if (it != reg.pending.end()) {
+			cgroup = it->second;
+			reg.pending.erase(it);
+		}
+	}
+	if (!cgroup.empty()) place_thread(cgroup.c_str(), me);
+
+	void *res = args.start_routine(args.arg);
+
+	// threads ending with pthread_exit or by cancellation stay registered until the pthread_t is reused
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.tids.erase(self);
+	return res;
+}
+
+// never destroyed, threads may still use it while the process exits
+static thread_registry &registry() {
+	static auto *reg = new thread_registry;
+	return *reg;
+}
+
+static const char *select_cgroup_by_name(const char *thread_name) {
+	for (const auto &entry : config().cgroups) {
+		if (strncmp(thread_name, entry.first.c_str(), entry.first.size()) == 0) return entry.second.c_str();
+	}
+	return nullptr;
+}
+
+static void place_thread(const char *cgroup, pid_t tid) {
+	if (cgroup == nullptr) return;
+
+	// the application does not expect exceptions from pthread functions
+	try {
+		cgroup_add_task(cgroup, tid);
+	} catch (const std::exception &e) {
+		fprintf(stderr, "libponci_preload: could not add thread to cgroup %s: %s\n", cgroup, e.what());
+	}
+}
+
+static const preload_config &config() {
+	static const preload_config conf = [] {
+		preload_config res;
+
+		const char *policy = std::getenv("PONCI_PRELOAD_POLICY");
+		if (policy != nullptr) {
+			if (strcmp(policy, "order") == 0) {
+				res.policy = placement_policy::order;
+			} else if (strcmp(policy, "name") == 0) {
+				res.policy = placement_policy::name;
+			} else if (strcmp(policy, "rr") != 0) {
+				fprintf(stderr, "libponci_preload: unknown policy %s, using rr\n", policy);
+			}
+		}
+
+		const char *env = std::getenv("PONCI_PRELOAD_CGROUPS");
+		if (env == nullptr) return res;
+
+		std::string list(env);
+		size_t start = 0;
+		while (start < list.size()) {
+			size_t end = list.find(',', start);
+			if (end == std::string::npos) end = list.size();
+
+			const auto entry = list.substr(start, end - start);
+			const auto eq = entry.find('=');
+			if (res.policy != placement_policy::name) {
+				if (!entry.empty()) res.cgroups.emplace_back(std::string(), entry);
+			} else if (eq == std::string::npos || eq == 0) {
+				// an empty prefix would match every thread name
+				if (!entry.empty()) {
+					fprintf(stderr, "libponci_preload: ignoring %s, expected name=cgroup\n", entry.c_str());
+				}
+			} else {
+				res.cgroups.emplace_back(entry.substr(0, eq), entry.substr(eq + 1));
+			}
+
+			start = end + 1;
+		}
+
+		return res;
+	}();
+
+	return conf;
+}
+
+template <typename T> static T next_symbol(const char *symbol) {
+	auto res = reinterpret_cast<T>(dlsym(RTLD_NEXT, symbol));
+	if (res == nullptr) {
+		fprintf(stderr, "libponci_preload: could not find %s: %s\n", symbol, dlerror());
+		std::abort();
+	}
+	return res;
+}
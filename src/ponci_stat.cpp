@@ -0,0 +1,313 @@
+/**
+ * po     n  c       i
+ * poor mans cgroups interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "ponci/ponci.hpp"
+
+#include "fileIO_helper.hpp"
+#include "ponci_internal.hpp"
+
+#include <string>
+#include <vector>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+// initial size of the buffer used to read the statistic files, it grows if a file does not fit
+static constexpr std::size_t stat_buf_size = 8192;
+
+/////////////////////////////////////////////////////////////////
+// PROTOTYPES
+/////////////////////////////////////////////////////////////////
+static void sample_cpu_v1(const char *name, cgroup_cpu_stat &stat, std::vector<char> &buf);
+static void sample_cpu_v2(const char *name, cgroup_cpu_stat &stat, std::vector<char> &buf);
+static void parse_memory_stat(const char *buf, cgroup_memory_stat &stat);
+static void parse_numa_stat(const char *buf, cgroup_memory_stat &stat, uint64_t unit);
+static std::string memory_path(const char *name);
+
+
+/////////////////////////////////////////////////////////////////
+// EXPORTED FUNCTIONS
+/////////////////////////////////////////////////////////////////
+void cgroup_sample_cpu(const char *const *names, size_t size, cgroup_cpu_stat *stats) {
+	const bool is_v2 = cgroup_is_v2();
+
+	std::vector<char> buf(stat_buf_size);
+	for (size_t i = 0; i < size; ++i) {
+		memset(&stats[i], 0, sizeof(cgroup_cpu_stat));
+		stats[i].timestamp = get_timestamp();
+
+		if (is_v2) {
+			sample_cpu_v2(names[i], stats[i], buf);
+		} else {
+			sample_cpu_v1(names[i], stats[i], buf);
+		}
+	}
+}
+
+std::vector<cgroup_cpu_stat> cgroup_sample_cpu(const std::vector<std::string> &names) {
+	std::vector<const char *> c_names;
+	for (const auto &name : names) c_names.push_back(name.c_str());
+
+	std::vector<cgroup_cpu_stat> stats(names.size());
+	cgroup_sample_cpu(c_names.data(), names.size(), stats.data());
+	return stats;
+}
+
+void cgroup_sample_memory(const char *const *names, size_t size, cgroup_memory_stat *stats) {
+	const bool is_v2 = cgroup_is_v2();
+	// numa_stat is reported in pages on v1 and in bytes on v2
+	static const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+	std::vector<char> buf(stat_buf_size);
+	for (size_t i = 0; i < size; ++i) {
+		auto &stat = stats[i];
+		memset(&stat, 0, sizeof(cgroup_memory_stat));
+
+		const auto cgp = memory_path(names[i]);
+
+		read_file_to_vector((cgp + std::string(is_v2 ? "memory.current" : "memory.usage_in_bytes")).c_str(), buf);
+		stat.usage = strtoull(buf.data(), nullptr, 10);
+
+		const std::string max_usage = is_v2 ? "memory.peak" : "memory.max_usage_in_bytes";
+		read_file_to_vector((cgp + max_usage).c_str(), buf, is_v2);
+		stat.max_usage = strtoull(buf.data(), nullptr, 10);
+
+		read_file_to_vector((cgp + std::string("memory.stat")).c_str(), buf);
+		parse_memory_stat(buf.data(), stat);
+
+		read_file_to_vector((cgp + std::string("memory.numa_stat")).c_str(), buf, true);
+		parse_numa_stat(buf.data(), stat, is_v2 ? 1 : page_size);
+	}
+}
+
+std::vector<cgroup_memory_stat> cgroup_sample_memory(const std::vector<std::string> &names) {
+	std::vector<const char *> c_names;
+	for (const auto &name : names) c_names.push_back(name.c_str());
+
+	std::vector<cgroup_memory_stat> stats(names.size());
+	cgroup_sample_memory(c_names.data(), names.size(), stats.data());
+	return stats;
+}
+
+uint64_t cgroup_get_memory_usage(const char *name) {
+	const auto filename = memory_path(name) + std::string(cgroup_is_v2() ? "memory.current" : "memory.usage_in_bytes");
+
+	char buf[64];
+	read_file_to_buffer(filename.c_str(), buf, sizeof(buf));
+	return strtoull(buf, nullptr, 10);
+}
+
+void cgroup_cpu_stat_delta(const cgroup_cpu_stat *first, const cgroup_cpu_stat *second, cgroup_cpu_stat *delta) {
+	delta->timestamp = second->timestamp - first->timestamp;
+	delta->usage = second->usage - first->usage;
+	delta->user = second->user - first->user;
+	delta->system = second->system - first->system;
+	delta->nr_periods = second->nr_periods - first->nr_periods;
+	delta->nr_throttled = second->nr_throttled - first->nr_throttled;
+	delta->throttled = second->throttled - first->throttled;
+
+	delta->num_cpus = first->num_cpus < second->num_cpus ? first->num_cpus : second->num_cpus;
+	delta->num_cpus_total =
+		first->num_cpus_total < second->num_cpus_total ? first->num_cpus_total : second->num_cpus_total;
+	for (size_t i = 0; i < delta->num_cpus; ++i) {
+		delta->usage_percpu[i] = second->usage_percpu[i] - first->usage_percpu[i];
+	}
+}
+
+void cgroup_cpu_stat_rate(const cgroup_cpu_stat *first, const cgroup_cpu_stat *second, cgroup_cpu_rate *rate) {
+	memset(rate, 0, sizeof(cgroup_cpu_rate));
+
+	assert(second->timestamp >= first->timestamp);
+	const auto elapsed = static_cast<double>(second->timestamp - first->timestamp);
+	if (elapsed == 0.0) return;
+
+	rate->usage = static_cast<double>(second->usage - first->usage) / elapsed;
+	rate->user = static_cast<double>(second->user - first->user) / elapsed;
+	rate->system = static_cast<double>(second->system - first->system) / elapsed;
+	rate->throttled = static_cast<double>(second->throttled - first->throttled) / elapsed;
+
+	const auto periods = second->nr_periods - first->nr_periods;
+	if (periods != 0) {
+		rate->throttled_periods =
+			static_cast<double>(second->nr_throttled - first->nr_throttled) / static_cast<double>(periods);
+	}
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+static void sample_cpu_v1(const char *name, cgroup_cpu_stat &stat, std::vector<char> &buf) {
+	const auto cgp = cgroup_path(name);
+	auto cpuacct = cgp;
+	replace_subsystem_in_path(cpuacct, "cpuacct");
+
+	read_file_to_vector((cpuacct + std::string("cpuacct.usage")).c_str(), buf);
+	stat.usage = strtoull(buf.data(), nullptr, 10);
+
+	read_file_to_vector((cpuacct + std::string("cpuacct.usage_percpu")).c_str(), buf);
+	const char *pos = buf.data();
+	while (true) {
+		char *end;
+		const uint64_t value = strtoull(pos, &end, 10);
+		if (end == pos) break;
+		// CPUs beyond PONCI_MAX_CPUS are only counted, the caller sees the truncation in num_cpus_total
+		if (stat.num_cpus < PONCI_MAX_CPUS) stat.usage_percpu[stat.num_cpus++] = value;
+		++stat.num_cpus_total;
+		pos = end;
+	}
+
+	// cpuacct.stat is reported in USER_HZ
+	static const uint64_t ns_per_tick = 1000000000ull / static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+	read_file_to_vector((cpuacct + std::string("cpuacct.stat")).c_str(), buf);
+	for_each_key_value(buf.data(), [&stat](const stat_key &key, uint64_t value) {
+		switch (key.hash) {
+		case hash_key("user"): if (key == "user") stat.user = value * ns_per_tick; break;
+		case hash_key("system"): if (key == "system") stat.system = value * ns_per_tick; break;
+		}
+	});
+
+	// throttling is reported by the cpu controller, which may not be mounted
+	auto cpu = cgp;
+	replace_subsystem_in_path(cpu, "cpu");
+	read_file_to_vector((cpu + std::string("cpu.stat")).c_str(), buf, true);
+	for_each_key_value(buf.data(), [&stat](const stat_key &key, uint64_t value) {
+		switch (key.hash) {
+		case hash_key("nr_periods"): if (key == "nr_periods") stat.nr_periods = value; break;
+		case hash_key("nr_throttled"): if (key == "nr_throttled") stat.nr_throttled = value; break;
+		case hash_key("throttled_time"): if (key == "throttled_time") stat.throttled = value; break;
+		}
+	});
+}
+
+static void sample_cpu_v2(const char *name, cgroup_cpu_stat &stat, std::vector<char> &buf) {
+	auto cgp = cgroup_path(name);
+	replace_subsystem_in_path(cgp, "");
+
+	read_file_to_vector((cgp + std::string("cpu.stat")).c_str(), buf);
+	for_each_key_value(buf.data(), [&stat](const stat_key &key, uint64_t value) {
+		switch (key.hash) {
+		case hash_key("usage_usec"): if (key == "usage_usec") stat.usage = value * 1000; break;
+		case hash_key("user_usec"): if (key == "user_usec") stat.user = value * 1000; break;
+		case hash_key("system_usec"): if (key == "system_usec") stat.system = value * 1000; break;
+		case hash_key("nr_periods"): if (key == "nr_periods") stat.nr_periods = value; break;
+		case hash_key("nr_throttled"): if (key == "nr_throttled") stat.nr_throttled = value; break;
+		case hash_key("throttled_usec"): if (key == "throttled_usec") stat.throttled = value * 1000; break;
+		}
+	});
+}
+
+static std::string memory_path(const char *name) {
+	auto cgp = cgroup_path(name);
+	replace_subsystem_in_path(cgp, cgroup_is_v2() ? "" : "memory");
+	return cgp;
+}
+
+// memory.stat contains one "key value" pair per line, keys of v1 and v2 are both handled
+static void parse_memory_stat(const char *buf, cgroup_memory_stat &stat) {
+	for_each_key_value(buf, [&stat](const stat_key &key, uint64_t value) {
+		switch (key.hash) {
+		case hash_key("cache"):
+		case hash_key("file"):
+			if (key == "cache" || key == "file") stat.cache = value;
+			break;
+		case hash_key("rss"):
+		case hash_key("anon"):
+			if (key == "rss" || key == "anon") stat.rss = value;
+			break;
+		case hash_key("rss_huge"):
+		case hash_key("anon_thp"):
+			if (key == "rss_huge" || key == "anon_thp") stat.rss_huge = value;
+			break;
+		case hash_key("shmem"): if (key == "shmem") stat.shmem = value; break;
+		case hash_key("mapped_file"):
+		case hash_key("file_mapped"):
+			if (key == "mapped_file" || key == "file_mapped") stat.mapped_file = value;
+			break;
+		case hash_key("dirty"):
+		case hash_key("file_dirty"):
+			if (key == "dirty" || key == "file_dirty") stat.dirty = value;
+			break;
+		case hash_key("writeback"):
+		case hash_key("file_writeback"):
+			if (key == "writeback" || key == "file_writeback") stat.writeback = value;
+			break;
+		case hash_key("inactive_anon"): if (key == "inactive_anon") stat.inactive_anon = value; break;
+		case hash_key("active_anon"): if (key == "active_anon") stat.active_anon = value; break;
+		case hash_key("inactive_file"): if (key == "inactive_file") stat.inactive_file = value; break;
+		case hash_key("active_file"): if (key == "active_file") stat.active_file = value; break;
+		case hash_key("unevictable"): if (key == "unevictable") stat.unevictable = value; break;
+		case hash_key("pgfault"): if (key == "pgfault") stat.pgfault = value; break;
+		case hash_key("pgmajfault"): if (key == "pgmajfault") stat.pgmajfault = value; break;
+		}
+	});
+}
+
+// memory.numa_stat contains one line per key with the values per node, e.g.
+// v1: "total=1234 N0=1000 N1=234"
+// v2: "anon N0=1000 N1=234"
+static void parse_numa_stat(const char *buf, cgroup_memory_stat &stat, uint64_t unit) {
+	bool has_total = false;
+
+	while (*buf != '\0') {
+		stat_key key{hash_key(""), buf, 0};
+		while (*buf != ' ' && *buf != '=' && *buf != '\n' && *buf != '\0') {
+			key.hash = (key.hash ^ static_cast<unsigned char>(*buf)) * 1099511628211ull;
+			++buf;
+		}
+		key.len = static_cast<size_t>(buf - key.str);
+
+		uint64_t *values = nullptr;
+		switch (key.hash) {
+		case hash_key("total"):
+			if (key == "total") {
+				values = stat.numa_total;
+				has_total = true;
+			}
+			break;
+		case hash_key("file"): if (key == "file") values = stat.numa_file; break;
+		case hash_key("anon"): if (key == "anon") values = stat.numa_anon; break;
+		}
+
+		// skip the total of v1
+		if (*buf == '=') {
+			char *end;
+			strtoull(buf + 1, &end, 10);
+			buf = end;
+		}
+
+		while (*buf == ' ') {
+			++buf;
+			if (*buf != 'N') break;
+
+			char *end;
+			const auto node = static_cast<size_t>(strtoull(buf + 1, &end, 10));
+			const uint64_t value = strtoull(end + 1, &end, 10);
+			buf = end;
+
+			if (values != nullptr && node < PONCI_MAX_NUMA_NODES) {
+				values[node] = value * unit;
+				if (node >= stat.num_nodes) stat.num_nodes = node + 1;
+			}
+		}
+
+		while (*buf != '\n' && *buf != '\0') ++buf;
+		if (*buf == '\n') ++buf;
+	}
+
+	// v2 has no total
+	if (!has_total) {
+		for (size_t i = 0; i < stat.num_nodes; ++i) stat.numa_total[i] = stat.numa_file[i] + stat.numa_anon[i];
+	}
+}
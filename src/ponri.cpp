@@ -1,13 +1,22 @@
 #include <ponri/ponri.hpp>
 
+#include "context.hpp"
 #include "fileIO_helper.hpp"
+#include "mountinfo.hpp"
+#include "ponri_internal.hpp"
+#include "topology_helper.hpp"
 
+#include <algorithm>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <vector>
 
-#include <cassert>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 #include <dirent.h>
@@ -16,22 +25,43 @@
 #include <syscall.h>
 #include <unistd.h>
 
-static inline std::string resgroup_path(const char *name);
-
-void resgroup_create(const char *name) {
-	const auto rgp = resgroup_path(name);
-	const int err = mkdir(rgp.c_str(), S_IRWXU | S_IRWXG);
+static bool check_is_mba_mbps();
+static std::vector<unsigned int> read_domains(const std::string &resource);
+static resgroup_schemata read_schemata_file(const std::string &filename, bool hex_masks);
+static unsigned int cache_level(resctrl_resource res);
+static void copy_domains(const resgroup_schemata &schemata, const std::string &resource, unsigned int *domains,
+						 size_t &size, size_t &total);
+static uint64_t read_info_value(const std::string &filename, int base);
+static const resctrl_cache_info &cache_info(resctrl_resource res);
+static const resctrl_info &mb_info();
+static resctrl_info *read_info();
+
+// bodies shared by the _r and the throwing functions, they return the errno code of a failed write and throw
+// std::system_error if resctrl cannot be discovered
+static int create_resgroup(const char *name);
+static int delete_resgroup(const char *name);
+static int add_task_to_resgroup(const char *name, pid_t tid);
+static int write_resgroup_cpus(const char *name, const size_t *cpus, size_t size);
+static int write_resource_schemata(const char *name, resctrl_resource res, const size_t *values, size_t size);
+static int write_mb(const char *name, const size_t *bandwidths, size_t size);
+static int write_schemata(const std::string &name, const resgroup_schemata &desired);
+static int write_schemata_entry(const char *name, const char *resource, unsigned int domain, uint64_t value);
+
+int resgroup_create_r(const char *name) {
+	return no_throw([name] { return create_resgroup(name); });
+}
 
-	if (err != 0 && errno != EEXIST) throw std::runtime_error(strerror(errno));
+void resgroup_create(const char *name) { throw_on_error(create_resgroup(name)); }
 
-	errno = 0;
+int resgroup_delete_r(const char *name) {
+	return no_throw([name] { return delete_resgroup(name); });
 }
 
-void resgroup_delete(const char *name) {
-	const auto rgp = resgroup_path(name);
-	const int err = rmdir(rgp.c_str());
+void resgroup_delete(const char *name) { throw_on_error(delete_resgroup(name)); }
 
-	if (err != 0) throw std::runtime_error(strerror(errno));
+int resgroup_add_me_r(const char *name) {
+	auto me = static_cast<pid_t>(syscall(SYS_gettid));
+	return resgroup_add_task_r(name, me);
 }
 
 void resgroup_add_me(const char *name) {
@@ -39,92 +69,249 @@ void resgroup_add_me(const char *name) {
 	resgroup_add_task(name, me);
 }
 
-void resgroup_add_task(const char *name, const pid_t tid) {
-	auto cgp = resgroup_path(name);
-	cgp += std::string("tasks");
-	append_value_to_file(cgp, tid);
+int resgroup_add_task_r(const char *name, const pid_t tid) {
+	return no_throw([name, tid] { return add_task_to_resgroup(name, tid); });
 }
 
-void resgroup_set_cpus(const char *name, const size_t *cpus, size_t size) {
-	assert(size < 64);
-
-	auto cgp = resgroup_path(name);
-	std::string filename = cgp + std::string("cpus");
+void resgroup_add_task(const char *name, const pid_t tid) { throw_on_error(add_task_to_resgroup(name, tid)); }
 
-	// TODO magic number
-	std::bitset<64> bits;
-	for (size_t i = 0; i < size; ++i) {
-		bits.set(cpus[i]);
-	}
+void resgroup_set_cpus(const char *name, const size_t *cpus, size_t size) {
+	throw_on_error(write_resgroup_cpus(name, cpus, size));
+}
 
-	write_bitset_to_file(filename, bits);
+int resgroup_set_cpus_r(const char *name, const size_t *cpus, size_t size) {
+	return no_throw([=] { return write_resgroup_cpus(name, cpus, size); });
 }
 
 void resgroup_set_cpus(const std::string &name, const std::vector<size_t> &cpus) {
-	resgroup_set_cpus(name.c_str(), &cpus[0], cpus.size());
+	resgroup_set_cpus(name.c_str(), cpus.data(), cpus.size());
 }
 
-// TODO support L2
 void resgroup_set_schemata(const char *name, const size_t *schematas, size_t size) {
+	resgroup_set_resource_schemata(name, RESCTRL_L3, schematas, size);
+}
+
+void resgroup_set_resource_schemata(const char *name, enum resctrl_resource res, const size_t *schematas, size_t size) {
+	throw_on_error(write_resource_schemata(name, res, schematas, size));
+}
+
+int resgroup_set_schemata_r(const char *name, const size_t *schematas, size_t size) {
+	return no_throw([=] { return write_resource_schemata(name, RESCTRL_L3, schematas, size); });
+}
+
+int resgroup_set_resource_schemata_r(const char *name, enum resctrl_resource res, const size_t *schematas,
+									 size_t size) {
+	return no_throw([=] { return write_resource_schemata(name, res, schematas, size); });
+}
+
+void resgroup_set_schemata(const std::string &name, const std::vector<size_t> &schematas) {
+	resgroup_set_schemata(name.c_str(), &schematas[0], schematas.size());
+}
+
+void resgroup_set_schemata(const std::string &name, resctrl_resource res, const std::vector<size_t> &schematas) {
+	resgroup_set_resource_schemata(name.c_str(), res, &schematas[0], schematas.size());
+}
+
+int resgroup_set_schemata_entry_r(const char *name, const char *resource, unsigned int domain, uint64_t value) {
+	return no_throw([=] { return write_schemata_entry(name, resource, domain, value); });
+}
+
+void resgroup_set_schemata_entry(const char *name, const char *resource, unsigned int domain, uint64_t value) {
+	throw_on_error(write_schemata_entry(name, resource, domain, value));
+}
+
+resgroup_schemata resgroup_get_schemata(const std::string &name) {
 	/*
 	 $ cat /sys/fs/resctrl/a/schemata
-	 L3:0=fffff;1=fffff
+	     L3:0=fffff;1=fffff
+	     MB:0=100;1=100
 	 */
-	auto cgp = resgroup_path(name);
-	std::string filename = cgp + std::string("schemata");
+	return read_schemata_file(resgroup_path(name.c_str()) + std::string("schemata"), true);
+}
 
-	std::string content = "L3:";
-	for (size_t i = 0; i < size; ++i) {
-		content += std::to_string(i) + "=";
+resgroup_schemata resgroup_get_size(const std::string &name) {
+	/*
+	 $ cat /sys/fs/resctrl/a/size
+	     L3:0=11534336;1=11534336
+	     MB:0=100;1=100
+	 */
+	return read_schemata_file(resgroup_path(name.c_str()) + std::string("size"), false);
+}
 
-		std::stringstream stream;
-		stream << std::hex << schematas[i];
-		content += stream.str();
+void resgroup_write_schemata(const std::string &name, const resgroup_schemata &desired) {
+	throw_on_error(write_schemata(name, desired));
+}
 
-		if (i + 1 != size)
-			content += ";";
-		else
-			content += "\n";
+resgroup_schemata resgroup_schemata_diff(const resgroup_schemata &current, const resgroup_schemata &desired) {
+	resgroup_schemata diff;
+	for (const auto &resource : desired) {
+		const auto cur_resource = current.find(resource.first);
+		for (const auto &domain : resource.second) {
+			if (cur_resource != current.end()) {
+				const auto cur_domain = cur_resource->second.find(domain.first);
+				if (cur_domain != cur_resource->second.end() && cur_domain->second == domain.second) continue;
+			}
+			diff[resource.first][domain.first] = domain.second;
+		}
 	}
+	return diff;
+}
 
-	write_value_to_file(filename, content);
+void resgroup_update_schemata(const std::string &name, const resgroup_schemata &desired) {
+	resgroup_write_schemata(name, resgroup_schemata_diff(resgroup_get_schemata(name), desired));
 }
 
-void resgroup_set_schemata(const std::string &name, const std::vector<size_t> &schematas) {
-	resgroup_set_schemata(name.c_str(), &schematas[0], schematas.size());
+void resgroup_set_mb(const char *name, const size_t *bandwidths, size_t size) {
+	throw_on_error(write_mb(name, bandwidths, size));
+}
+
+int resgroup_set_mb_r(const char *name, const size_t *bandwidths, size_t size) {
+	return no_throw([=] { return write_mb(name, bandwidths, size); });
+}
+
+void resgroup_set_mb(const std::string &name, const std::vector<size_t> &bandwidths) {
+	resgroup_set_mb(name.c_str(), &bandwidths[0], bandwidths.size());
+}
+
+std::uint64_t get_cbm_mask_as_uint() { return get_resource_cbm_mask(RESCTRL_L3); }
+
+unsigned int get_min_cbm_bits() { return get_resource_min_cbm_bits(RESCTRL_L3); }
+
+unsigned int get_num_closids() { return get_resource_num_closids(RESCTRL_L3); }
+
+std::uint64_t get_resource_cbm_mask(enum resctrl_resource res) { return cache_info(res).cbm_mask; }
+
+unsigned int get_resource_min_cbm_bits(enum resctrl_resource res) { return cache_info(res).min_cbm_bits; }
+
+unsigned int get_resource_num_closids(enum resctrl_resource res) { return cache_info(res).num_closids; }
+
+size_t get_resource_domains(enum resctrl_resource res, unsigned int *domains, size_t size) {
+	const auto ids = read_domains(resctrl_resource_name(res));
+	std::copy_n(ids.begin(), std::min(size, ids.size()), domains);
+	return ids.size();
+}
+
+std::vector<unsigned int> get_resource_domains(resctrl_resource res) {
+	return read_domains(resctrl_resource_name(res));
+}
+
+size_t get_domain_cpus(enum resctrl_resource res, unsigned int domain, size_t *cpus, size_t size) {
+	const auto list = get_cpus_of_cache(cache_level(res), domain);
+	std::copy_n(list.begin(), std::min(size, list.size()), cpus);
+	return list.size();
+}
+
+std::vector<size_t> get_domain_cpus(unsigned int domain, resctrl_resource res) {
+	return get_cpus_of_cache(cache_level(res), domain);
 }
 
-// TODO add enum parameter to select L2 or L3
-std::uint64_t get_cbm_mask_as_uint() {
-	const std::string filename = resgroup_path("info/L3/") + "cbm_mask";
-	const auto line = read_line_from_file(filename);
+size_t get_domain_numa_node(enum resctrl_resource res, unsigned int domain) {
+	const auto cpus = get_cpus_of_cache(cache_level(res), domain);
+	if (cpus.empty()) throw std::runtime_error("Unknown cache domain in libponri.");
 
-	std::stringstream converter(line);
-	std::uint64_t mask_as_uint;
-	converter >> std::hex >> mask_as_uint;
+	return get_numa_node_of_cpu(cpus.front());
+}
+
+const char *resctrl_resource_name(enum resctrl_resource res) {
+	switch (res) {
+	case RESCTRL_L3: return "L3";
+	case RESCTRL_L3CODE: return "L3CODE";
+	case RESCTRL_L3DATA: return "L3DATA";
+	case RESCTRL_L2: return "L2";
+	case RESCTRL_L2CODE: return "L2CODE";
+	case RESCTRL_L2DATA: return "L2DATA";
+	}
 
-	return mask_as_uint;
+	throw std::runtime_error("Unknown resctrl resource in libponri.");
 }
 
-// TODO add enum parameter to select L2 or L3
-unsigned int get_min_cbm_bits() {
-	const std::string filename = resgroup_path("info/L3/") + "min_cbm_bits";
-	const auto line = read_line_from_file(filename);
+unsigned int get_mb_min_bandwidth() { return mb_info().mb_min_bandwidth; }
+
+unsigned int get_mb_bandwidth_gran() { return mb_info().mb_bandwidth_gran; }
+
+int get_mba_mbps_mode() { return resctrl_get_info()->mba_mbps; }
+
+const resctrl_info *resctrl_get_info() {
+	auto &ctx = current_context();
+	auto info = ctx.info.load(std::memory_order_acquire);
+	if (info != nullptr) return info;
 
-	return static_cast<unsigned int>(std::stoi(line));
+	// threads racing for the first snapshot read it concurrently, only one of them is published
+	auto snapshot = read_info();
+	if (ctx.info.compare_exchange_strong(info, snapshot, std::memory_order_acq_rel)) return snapshot;
+	delete snapshot;
+	return info;
 }
 
-// TODO add enum parameter to select L2 or L3
-unsigned int get_num_closids() {
-	const std::string filename = resgroup_path("info/L3/") + "num_closids";
-	const auto line = read_line_from_file(filename);
+void resctrl_refresh_info() {
+	auto &ctx = current_context();
+	auto snapshot = read_info();
+
+	std::lock_guard<std::mutex> lock(ctx.info_mutex);
+	// pointers to the old snapshot may still be in use, so it is only retired (and kept) if it is outdated. Both
+	// snapshots are zeroed before they are filled, so they can be compared bytewise.
+	auto old = ctx.info.load(std::memory_order_acquire);
+	if (old != nullptr && memcmp(old, snapshot, sizeof(resctrl_info)) == 0) {
+		delete snapshot;
+		return;
+	}
+	// the first snapshot may be published by resctrl_get_info in the meantime
+	old = ctx.info.exchange(snapshot, std::memory_order_acq_rel);
+	if (old != nullptr) ctx.retired_info.push_back(old);
+}
+
+// reads the info directory and the domains of the default group
+static resctrl_info *read_info() {
+	auto info = new resctrl_info;
+	memset(info, 0, sizeof(resctrl_info));
+
+	const auto schemata = resgroup_get_schemata("");
+	const std::string info_path = resgroup_path("info/");
+	char buf[4096];
+
+	for (int i = 0; i < PONRI_NUM_CACHE_RESOURCES; ++i) {
+		const auto res = static_cast<resctrl_resource>(i);
+		auto &cache = info->cache[i];
+		const std::string path = info_path + resctrl_resource_name(res) + "/";
+
+		if (read_file_to_buffer((path + "cbm_mask").c_str(), buf, sizeof(buf), true) == 0) continue;
+		cache.available = 1;
+		cache.cbm_mask = strtoull(buf, nullptr, 16);
+		cache.min_cbm_bits = static_cast<unsigned int>(read_info_value(path + "min_cbm_bits", 10));
+		cache.num_closids = static_cast<unsigned int>(read_info_value(path + "num_closids", 10));
+		cache.shareable_bits = read_info_value(path + "shareable_bits", 16);
+		copy_domains(schemata, resctrl_resource_name(res), cache.domains, cache.num_domains, cache.num_domains_total);
+	}
+
+	const std::string mb_path = info_path + "MB/";
+	if (read_file_to_buffer((mb_path + "min_bandwidth").c_str(), buf, sizeof(buf), true) != 0) {
+		info->mb_available = 1;
+		info->mb_min_bandwidth = static_cast<unsigned int>(strtoul(buf, nullptr, 10));
+		info->mb_bandwidth_gran = static_cast<unsigned int>(read_info_value(mb_path + "bandwidth_gran", 10));
+		info->mb_num_closids = static_cast<unsigned int>(read_info_value(mb_path + "num_closids", 10));
+		copy_domains(schemata, "MB", info->mb_domains, info->mb_num_domains, info->mb_num_domains_total);
+	}
+	info->mba_mbps = check_is_mba_mbps() ? 1 : 0;
+
+	const std::string mon_path = info_path + "L3_MON/";
+	if (read_file_to_buffer((mon_path + "num_rmids").c_str(), buf, sizeof(buf), true) != 0) {
+		info->mon_available = 1;
+		info->num_rmids = static_cast<unsigned int>(strtoul(buf, nullptr, 10));
+
+		read_file_to_buffer((mon_path + "mon_features").c_str(), buf, sizeof(buf), true);
+		info->mon_llc_occupancy = strstr(buf, "llc_occupancy") != nullptr ? 1 : 0;
+		info->mon_mbm_total_bytes = strstr(buf, "mbm_total_bytes") != nullptr ? 1 : 0;
+		info->mon_mbm_local_bytes = strstr(buf, "mbm_local_bytes") != nullptr ? 1 : 0;
+	}
 
-	return static_cast<unsigned int>(std::stoi(line));
+	return info;
 }
 
-std::bitset<64> create_minimal_bitset() {
+std::bitset<64> create_minimal_bitset(resctrl_resource res) {
+	const auto min_cbm_bits = get_resource_min_cbm_bits(res);
+
 	std::bitset<64> bits;
-	for (size_t i = 0; i < get_min_cbm_bits(); ++i) {
+	for (size_t i = 0; i < min_cbm_bits; ++i) {
 		bits.set(i);
 	}
 	return bits;
@@ -144,10 +331,285 @@ std::bitset<64> increase_bitset(std::bitset<64> bits) {
 // INTERNAL FUNCTIONS
 /////////////////////////////////////////////////////////////////
 
-static inline std::string resgroup_path(const char *name) {
-	static const char *env = std::getenv("PONRI_PATH");
+static int create_resgroup(const char *name) {
+	const auto rgp = resgroup_path(name);
+	const int err = mkdir(rgp.c_str(), S_IRWXU | S_IRWXG);
+
+	if (err != 0 && errno != EEXIST) return errno;
+
+	errno = 0;
+	return 0;
+}
+
+static int delete_resgroup(const char *name) {
+	const auto rgp = resgroup_path(name);
+	const int err = rmdir(rgp.c_str());
+	if (err != 0) return errno;
+
+	// a new ressource group of the same name starts with the default schemata
+	current_context().cache.erase_group(name, true);
+	return 0;
+}
+
+static int add_task_to_resgroup(const char *name, const pid_t tid) {
+	auto cgp = resgroup_path(name);
+	cgp += std::string("tasks");
+	return write_int_to_file_r(cgp.c_str(), tid, true);
+}
+
+// the list format of cpus_list is not limited in the number of CPUs, unlike the mask of the cpus file
+static int write_resgroup_cpus(const char *name, const size_t *cpus, size_t size) {
+	const std::string filename = resgroup_path(name) + std::string("cpus_list");
+
+	// an empty list gives all CPUs back to the default group
+	if (size == 0) return write_buffer_to_file_r(filename.c_str(), "\n", 1);
+	return write_array_to_file_r(filename.c_str(), cpus, size);
+}
+
+// values[i] is written to the i-th domain of res
+static int write_resource_schemata(const char *name, resctrl_resource res, const size_t *values, size_t size) {
+	/*
+	 $ cat /sys/fs/resctrl/a/schemata
+	 L3:0=fffff;1=fffff
+	 */
+	if (res < RESCTRL_L3 || res > RESCTRL_L2DATA) return EINVAL;
+
+	const auto domains = read_domains(resctrl_resource_name(res));
+	if (size > domains.size()) return EINVAL;
+
+	resgroup_schemata entries;
+	auto &line = entries[resctrl_resource_name(res)];
+	for (size_t i = 0; i < size; ++i) {
+		line[domains[i]] = values[i];
+	}
+
+	return write_schemata(name, entries);
+}
+
+// bandwidths[i] is written to the i-th MB domain, percentages are adjusted to what the kernel accepts
+static int write_mb(const char *name, const size_t *bandwidths, size_t size) {
+	/*
+	 $ cat /sys/fs/resctrl/a/schemata
+	 MB:0=50;1=100
+	 */
+	const auto info = resctrl_get_info();
+	if (info->mb_available == 0) return ENODEV;
+
+	const auto domains = read_domains("MB");
+	if (size > domains.size()) return EINVAL;
+
+	const bool mbps = info->mba_mbps != 0;
+	const size_t min = mbps ? 0 : info->mb_min_bandwidth;
+	const size_t gran = mbps ? 1 : info->mb_bandwidth_gran;
+
+	resgroup_schemata entries;
+	auto &line = entries["MB"];
+	for (size_t i = 0; i < size; ++i) {
+		size_t bandwidth = bandwidths[i];
+		if (!mbps) {
+			// the kernel rejects values below the minimum and rounds up to the granularity
+			bandwidth = (std::max(bandwidth, min) + gran - 1) / gran * gran;
+			bandwidth = std::min(bandwidth, static_cast<size_t>(100));
+		}
+
+		line[domains[i]] = bandwidth;
+	}
+
+	return write_schemata(name, entries);
+}
+
+// writes the entries of desired, unless the write cache knows that they are already set
+static int write_schemata(const std::string &name, const resgroup_schemata &desired) {
+	const std::string filename = resgroup_path(name.c_str()) + std::string("schemata");
+	const auto write = [&filename](const resgroup_schemata &entries) {
+		std::string content;
+		for (const auto &resource : entries) {
+			if (resource.second.empty()) continue;
+
+			const bool is_hex = !is_bandwidth_resource(resource.first);
+
+			std::stringstream stream;
+			stream << resource.first << ":";
+			for (auto it = resource.second.begin(); it != resource.second.end(); ++it) {
+				if (it != resource.second.begin()) stream << ";";
+				stream << std::dec << it->first << "=";
+				if (is_hex) stream << std::hex;
+				stream << it->second;
+			}
+			stream << "\n";
+
+			content += stream.str();
+		}
+
+		if (content.empty()) return 0;
+		return write_buffer_to_file_r(filename.c_str(), content.c_str(), content.size());
+	};
+
+	auto &ctx = current_context();
+	if (!ctx.cache_enabled.load(std::memory_order_relaxed)) return write(desired);
+
+	// entries the write cache knows to be set are not written again
+	std::vector<write_cache::entry> entries;
+	for (const auto &resource : desired) {
+		for (const auto &domain : resource.second) {
+			entries.push_back(write_cache::entry{write_cache::attribute::schemata, name, resource.first, domain.first,
+												 write_cache::schemata_value(domain.second)});
+		}
+	}
+	return ctx.cache.write(entries, [&desired, &write](const std::vector<write_cache::entry> &changed) {
+		resgroup_schemata schemata;
+		for (const auto &e : changed) schemata[e.resource][e.domain] = desired.at(e.resource).at(e.domain);
+		return write(schemata);
+	});
+}
+
+// writes a single schemata entry, unless the write cache knows that it is already set
+static int write_schemata_entry(const char *name, const char *resource, unsigned int domain, uint64_t value) {
+	const std::string filename = resgroup_path(name) + std::string("schemata");
+
+	char buf[128];
+	const char *format = is_bandwidth_resource(resource) ? "%s:%u=%" PRIu64 "\n" : "%s:%u=%" PRIx64 "\n";
+	const int len = snprintf(buf, sizeof(buf), format, resource, domain, value);
+	if (len < 0 || static_cast<size_t>(len) >= sizeof(buf)) return EINVAL;
+
+	const auto write = [&filename, &buf, len] {
+		return write_buffer_to_file_r(filename.c_str(), buf, static_cast<size_t>(len));
+	};
+
+	auto &ctx = current_context();
+	if (!ctx.cache_enabled.load(std::memory_order_relaxed)) return write();
+
+	const write_cache::entry entry{write_cache::attribute::schemata, name, resource, domain,
+								   write_cache::schemata_value(value)};
+	return ctx.cache.write({entry}, [&write](const std::vector<write_cache::entry> &) { return write(); });
+}
+
+// parses a file in the schemata format, values of cache resources are hexadecimal if hex_masks is set
+static resgroup_schemata read_schemata_file(const std::string &filename, bool hex_masks) {
+	// the file has a line per resource with an entry per domain, it grows with the number of domains
+	std::vector<char> buf;
+	read_file_to_vector(filename.c_str(), buf);
+
+	resgroup_schemata res;
+	std::istringstream stream(buf.data());
+	std::string line;
+	while (std::getline(stream, line)) {
+		const auto colon = line.find(':');
+		if (colon == std::string::npos) continue;
+
+		const auto first = line.find_first_not_of(' ');
+		const std::string resource = line.substr(first, colon - first);
+		const int base = (hex_masks && !is_bandwidth_resource(resource)) ? 16 : 10;
+		auto &domains = res[resource];
+
+		const char *pos = line.c_str() + colon + 1;
+		while (*pos != '\0') {
+			char *end;
+			const auto domain = static_cast<unsigned int>(strtoul(pos, &end, 10));
+			if (end == pos || *end != '=') break;
+			domains[domain] = strtoull(end + 1, &end, base);
+			pos = (*end == ';') ? end + 1 : end;
+		}
+	}
+
+	return res;
+}
+
+// returns the (sorted) domain ids of resource
+// domain ids are cache ids and may not be consecutive, e.g. 0 and 2
+static std::vector<unsigned int> read_domains(const std::string &resource) {
+	const auto info = resctrl_get_info();
+
+	std::vector<unsigned int> ret;
+	if (resource == "MB") {
+		ret.assign(info->mb_domains, info->mb_domains + info->mb_num_domains);
+	}
+	for (int i = 0; i < PONRI_NUM_CACHE_RESOURCES; ++i) {
+		const auto &cache = info->cache[i];
+		if (resource == resctrl_resource_name(static_cast<resctrl_resource>(i))) {
+			ret.assign(cache.domains, cache.domains + cache.num_domains);
+		}
+	}
+
+	return ret;
+}
+
+// copies the first PONRI_MAX_DOMAINS domain ids of resource, total is the number of all domains
+static void copy_domains(const resgroup_schemata &schemata, const std::string &resource, unsigned int *domains,
+						 size_t &size, size_t &total) {
+	size = 0;
+	total = 0;
+	const auto line = schemata.find(resource);
+	if (line == schemata.end()) return;
+
+	total = line->second.size();
+	for (const auto &domain : line->second) {
+		if (size == PONRI_MAX_DOMAINS) break;
+		domains[size++] = domain.first;
+	}
+}
+
+static uint64_t read_info_value(const std::string &filename, int base) {
+	char buf[64];
+	read_file_to_buffer(filename.c_str(), buf, sizeof(buf));
+	return strtoull(buf, nullptr, base);
+}
+
+static const resctrl_cache_info &cache_info(resctrl_resource res) {
+	const auto &cache = resctrl_get_info()->cache[res];
+	if (cache.available == 0) {
+		throw std::runtime_error(std::string(resctrl_resource_name(res)) + " not available in libponri.");
+	}
+	return cache;
+}
+
+static const resctrl_info &mb_info() {
+	const auto info = resctrl_get_info();
+	if (info->mb_available == 0) throw std::runtime_error("MB not available in libponri.");
+	return *info;
+}
+
+static unsigned int cache_level(resctrl_resource res) {
+	switch (res) {
+	case RESCTRL_L2:
+	case RESCTRL_L2CODE:
+	case RESCTRL_L2DATA: return 2;
+	default: return 3;
+	}
+}
+
+bool is_bandwidth_resource(const std::string &resource) { return resource == "MB" || resource == "SMBA"; }
+
+// check if the resctrl mount of the context is mounted with the mba_MBps option
+static bool check_is_mba_mbps() {
+	const auto options = get_mount_options(current_context().resctrl_mount());
+	return std::find(options.begin(), options.end(), "mba_MBps") != options.end();
+}
+
+std::vector<std::string> list_resgroups() {
+	const auto root = resgroup_path("");
+	DIR *dir = opendir(root.c_str());
+	if (dir == nullptr) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	std::vector<std::string> res;
+	dirent *dent;
+	while ((dent = readdir(dir)) != nullptr) {
+		if (dent->d_type != DT_DIR || dent->d_name[0] == '.') continue;
+		if (strcmp(dent->d_name, "info") == 0 || strcmp(dent->d_name, "mon_groups") == 0 ||
+			strcmp(dent->d_name, "mon_data") == 0) {
+			continue;
+		}
+		res.emplace_back(dent->d_name);
+	}
+	closedir(dir);
+
+	return res;
+}
 
-	std::string res(env != nullptr ? std::string(env) : std::string("/sys/fs/resctrl"));
+std::string resgroup_path(const char *name) {
+	std::string res(current_context().resctrl_mount());
 	res.append("/");
 
 	if (strcmp(name, "") != 0) {
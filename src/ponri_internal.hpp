@@ -0,0 +1,18 @@
+#ifndef ponri_internal
+#define ponri_internal
+
+#include <string>
+#include <vector>
+
+// Functions shared by the libponri translation units. Not part of the public interface.
+
+// returns the path of the ressource group name
+std::string resgroup_path(const char *name);
+
+// returns the names of all ressource groups, not including the default group
+std::vector<std::string> list_resgroups();
+
+// values of bandwidth resources (MB, SMBA) are decimal, all others are hexadecimal bit masks
+bool is_bandwidth_resource(const std::string &resource);
+
+#endif /* end of include guard: ponri_internal */
@@ -0,0 +1,218 @@
+/**
+ * po     n  r       i
+ * poor mans resctrl interface
+ *
+ * Copyright 2016 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <ponri/ponri.hpp>
+
+#include "fileIO_helper.hpp"
+#include "ponri_internal.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <syscall.h>
+#include <unistd.h>
+
+static std::string mon_group_path(const char *group, const char *name);
+static unsigned int count_mon_groups(const std::string &path);
+static uint64_t read_counter(const std::string &filename);
+static inline double counter_rate(uint64_t first, uint64_t second, double elapsed);
+
+// bodies shared by the _r and the throwing functions, they return the errno code of a failed write
+static int create_mon_group(const char *group, const char *name);
+static int delete_mon_group(const char *group, const char *name);
+static int add_task_to_mon_group(const char *group, const char *name, pid_t tid);
+
+void resgroup_sample_mon(const char *name, resgroup_mon_stat *stat) {
+	memset(stat, 0, sizeof(resgroup_mon_stat));
+
+	const std::string mon_data = resgroup_path(name) + std::string("mon_data/");
+	DIR *dir = opendir(mon_data.c_str());
+	if (dir == nullptr) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	std::vector<unsigned int> domains;
+	dirent *dent;
+	while ((dent = readdir(dir)) != nullptr) {
+		if (strncmp(dent->d_name, "mon_L3_", 7) != 0) continue;
+		domains.push_back(static_cast<unsigned int>(strtoul(dent->d_name + 7, nullptr, 10)));
+	}
+	closedir(dir);
+
+	// the lowest domain ids are kept if there are more than PONRI_MAX_DOMAINS
+	std::sort(domains.begin(), domains.end());
+	stat->num_domains_total = domains.size();
+	stat->num_domains = std::min(domains.size(), static_cast<size_t>(PONRI_MAX_DOMAINS));
+	std::copy_n(domains.begin(), stat->num_domains, stat->domains);
+
+	stat->timestamp = get_timestamp();
+	char domain[16];
+	for (size_t i = 0; i < stat->num_domains; ++i) {
+		snprintf(domain, sizeof(domain), "mon_L3_%02u/", stat->domains[i]);
+		const std::string path = mon_data + domain;
+
+		stat->llc_occupancy[i] = read_counter(path + std::string("llc_occupancy"));
+		stat->mbm_total_bytes[i] = read_counter(path + std::string("mbm_total_bytes"));
+		stat->mbm_local_bytes[i] = read_counter(path + std::string("mbm_local_bytes"));
+	}
+}
+
+void resgroup_mon_stat_rate(const resgroup_mon_stat *first, const resgroup_mon_stat *second, resgroup_mon_rate *rate) {
+	memset(rate, 0, sizeof(resgroup_mon_rate));
+
+	rate->num_domains = second->num_domains;
+	rate->num_domains_total = second->num_domains_total;
+	const auto elapsed = static_cast<double>(second->timestamp - first->timestamp) / 1e9;
+
+	for (size_t i = 0; i < second->num_domains; ++i) {
+		rate->domains[i] = second->domains[i];
+		rate->llc_occupancy[i] = second->llc_occupancy[i];
+
+		// the domains of both samples are sorted, but may differ if a domain went offline
+		const auto pos = std::find(first->domains, first->domains + first->num_domains, second->domains[i]);
+		if (pos == first->domains + first->num_domains || elapsed <= 0.0) continue;
+		const auto j = static_cast<size_t>(pos - first->domains);
+
+		rate->mbm_total[i] = counter_rate(first->mbm_total_bytes[j], second->mbm_total_bytes[i], elapsed);
+		rate->mbm_local[i] = counter_rate(first->mbm_local_bytes[j], second->mbm_local_bytes[i], elapsed);
+	}
+}
+
+int resgroup_mon_create_r(const char *group, const char *name) {
+	return no_throw([group, name] { return create_mon_group(group, name); });
+}
+
+void resgroup_mon_create(const char *group, const char *name) { throw_on_error(create_mon_group(group, name)); }
+
+int resgroup_mon_delete_r(const char *group, const char *name) {
+	return no_throw([group, name] { return delete_mon_group(group, name); });
+}
+
+void resgroup_mon_delete(const char *group, const char *name) { throw_on_error(delete_mon_group(group, name)); }
+
+int resgroup_mon_add_me_r(const char *group, const char *name) {
+	auto me = static_cast<pid_t>(syscall(SYS_gettid));
+	return resgroup_mon_add_task_r(group, name, me);
+}
+
+void resgroup_mon_add_me(const char *group, const char *name) {
+	auto me = static_cast<pid_t>(syscall(SYS_gettid));
+	resgroup_mon_add_task(group, name, me);
+}
+
+int resgroup_mon_add_task_r(const char *group, const char *name, const pid_t tid) {
+	return no_throw([group, name, tid] { return add_task_to_mon_group(group, name, tid); });
+}
+
+void resgroup_mon_add_task(const char *group, const char *name, const pid_t tid) {
+	throw_on_error(add_task_to_mon_group(group, name, tid));
+}
+
+void resgroup_mon_sample(const char *group, const char *name, resgroup_mon_stat *stat) {
+	std::string mgp = std::string("mon_groups/") + std::string(name);
+	if (strcmp(group, "") != 0) mgp = std::string(group) + std::string("/") + mgp;
+
+	resgroup_sample_mon(mgp.c_str(), stat);
+}
+
+unsigned int get_num_rmids() {
+	const auto info = resctrl_get_info();
+	if (info->mon_available == 0) throw std::runtime_error("Monitoring not available in libponri.");
+	return info->num_rmids;
+}
+
+unsigned int get_num_used_rmids() {
+	const auto root = resgroup_path("");
+
+	// the default group and its monitoring groups
+	unsigned int used = 1 + count_mon_groups(root);
+
+	for (const auto &group : list_resgroups()) used += 1 + count_mon_groups(root + group + "/");
+
+	return used;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+// ENOSPC if all RMIDs are in use, like mkdir in the resctrl file system
+static int create_mon_group(const char *group, const char *name) {
+	if (get_num_used_rmids() >= get_num_rmids()) return ENOSPC;
+
+	const auto mgp = mon_group_path(group, name);
+	const int err = mkdir(mgp.c_str(), S_IRWXU | S_IRWXG);
+
+	if (err != 0 && errno != EEXIST) return errno;
+
+	errno = 0;
+	return 0;
+}
+
+static int delete_mon_group(const char *group, const char *name) {
+	const auto mgp = mon_group_path(group, name);
+	const int err = rmdir(mgp.c_str());
+
+	if (err != 0) return errno;
+	return 0;
+}
+
+static int add_task_to_mon_group(const char *group, const char *name, const pid_t tid) {
+	const auto filename = mon_group_path(group, name) + std::string("tasks");
+	return write_int_to_file_r(filename.c_str(), tid, true);
+}
+
+static std::string mon_group_path(const char *group, const char *name) {
+	return resgroup_path(group) + std::string("mon_groups/") + std::string(name) + std::string("/");
+}
+
+// returns the number of monitoring groups in the ressource group at path
+static unsigned int count_mon_groups(const std::string &path) {
+	DIR *dir = opendir((path + "mon_groups").c_str());
+	// no monitoring support
+	if (dir == nullptr) return 0;
+
+	unsigned int count = 0;
+	dirent *dent;
+	while ((dent = readdir(dir)) != nullptr) {
+		if (dent->d_type == DT_DIR && dent->d_name[0] != '.') ++count;
+	}
+	closedir(dir);
+
+	return count;
+}
+
+// the kernel reports "Unavailable" or "Error" if the counter cannot be read
+static uint64_t read_counter(const std::string &filename) {
+	char buf[64];
+	read_file_to_buffer(filename.c_str(), buf, sizeof(buf), true);
+
+	char *end;
+	const uint64_t value = strtoull(buf, &end, 10);
+	return end == buf ? PONRI_MON_UNAVAILABLE : value;
+}
+
+static inline double counter_rate(uint64_t first, uint64_t second, double elapsed) {
+	if (first == PONRI_MON_UNAVAILABLE || second == PONRI_MON_UNAVAILABLE) return 0.0;
+
+	// the kernel extends the hardware counters to 64 bit, a smaller value means the counter was reset
+	if (second < first) return 0.0;
+	return static_cast<double>(second - first) / elapsed;
+}
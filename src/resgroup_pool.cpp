@@ -0,0 +1,139 @@
+/**
+ * po     n  r       i
+ * poor mans resctrl interface
+ *
+ * Copyright 2016 by Jens Breitbart
+ * Jens Breitbart     <jbreitbart@gmail.com>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include <ponci/ponci.hpp>
+#include <ponri/ponri.hpp>
+
+#include "context.hpp"
+#include "fileIO_helper.hpp"
+#include "ponri_internal.hpp"
+#include "rollback_helper.hpp"
+
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void move_tasks_to_default(const std::string &group);
+static void delete_groups(const std::vector<std::string> &names);
+
+resgroup_pool::resgroup_pool(const std::string &prefix, size_t size)
+	: context(ponci_context_current()), templ(resgroup_get_schemata("")) {
+	// the default group and every existing ressource group use one CLOSID
+	if (size == 0) {
+		const auto used = static_cast<unsigned int>(1 + list_resgroups().size());
+		const unsigned int closids = get_num_closids();
+		size = closids > used ? closids - used : 0;
+	}
+
+	std::vector<std::string> created;
+	auto undo = make_rollback([&created] { delete_groups(created); });
+	for (size_t i = 0; i < size; ++i) {
+		const std::string name = prefix + std::to_string(i);
+		resgroup_create(name);
+		created.push_back(name);
+		groups.push_back(entry{name, resgroup_get_schemata(name), 0});
+	}
+	undo.commit();
+}
+
+resgroup_pool::~resgroup_pool() {
+	ponci_context_guard guard(context);
+	std::vector<std::string> names;
+	for (const auto &group : groups) names.push_back(group.name);
+	delete_groups(names);
+}
+
+std::string resgroup_pool::lease(const resgroup_schemata &schemata) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// a group is shared only if it is configured exactly like a fresh lease, the entries not in schemata are
+	// taken from the default group
+	auto full = templ;
+	for (const auto &resource : schemata) {
+		for (const auto &domain : resource.second) full[resource.first][domain.first] = domain.second;
+	}
+
+	entry *free_group = nullptr;
+	for (auto &group : groups) {
+		if (group.leases != 0 && group.schemata == full) {
+			++group.leases;
+			return group.name;
+		}
+		if (group.leases == 0 && free_group == nullptr) free_group = &group;
+	}
+
+	if (free_group == nullptr) throw std::runtime_error("No free ressource group in pool in libponri.");
+
+	ponci_context_guard guard(context);
+
+	// the full schemata is written, a previous lessee may have changed entries not in schemata. It may have done so
+	// outside of the write cache, so the cached entries of the group are dropped first.
+	current_context().cache.erase_group(free_group->name, true);
+	resgroup_write_schemata(free_group->name, full);
+	free_group->schemata = full;
+
+	free_group->leases = 1;
+	return free_group->name;
+}
+
+void resgroup_pool::release(const std::string &name) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto &group : groups) {
+		if (group.name != name) continue;
+
+		if (group.leases == 0) throw std::runtime_error("Ressource group is not leased in libponri.");
+		if (--group.leases == 0) {
+			ponci_context_guard guard(context);
+			move_tasks_to_default(group.name);
+		}
+		return;
+	}
+
+	throw std::runtime_error("Ressource group is not part of the pool in libponri.");
+}
+
+size_t resgroup_pool::leased() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t ret = 0;
+	for (const auto &group : groups) {
+		if (group.leases != 0) ++ret;
+	}
+	return ret;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+static void move_tasks_to_default(const std::string &group) {
+	const auto tids = read_lines_from_file<pid_t>(resgroup_path(group.c_str()) + std::string("tasks"));
+	for (const auto tid : tids) {
+		// the task may have exited in the meantime
+		try {
+			resgroup_add_task("", tid);
+		} catch (const std::runtime_error &) {
+		}
+	}
+}
+
+// never throws, we clean up as much as possible. Also used if the constructor fails half way.
+static void delete_groups(const std::vector<std::string> &names) {
+	for (const auto &name : names) {
+		try {
+			move_tasks_to_default(name);
+		} catch (const std::runtime_error &) {
+		}
+		resgroup_delete_r(name.c_str());
+	}
+}
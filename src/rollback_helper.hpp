@@ -0,0 +1,33 @@
+#ifndef rollback_helper
+#define rollback_helper
+
+#include <utility>
+
+// Undoes the partial work of a constructor creating several groups: the destructor calls the function unless
+// commit() was called before. Exceptions of the function are dropped, so the exception that aborted the
+// constructor is the one seen by the caller.
+template <typename F> class rollback {
+  public:
+	explicit rollback(F f) : undo(std::move(f)) {}
+	rollback(rollback &&other) : undo(std::move(other.undo)), committed(other.committed) { other.committed = true; }
+	~rollback() {
+		if (committed) return;
+		try {
+			undo();
+		} catch (...) {
+		}
+	}
+
+	rollback(const rollback &) = delete;
+	rollback &operator=(const rollback &) = delete;
+
+	void commit() { committed = true; }
+
+  private:
+	F undo;
+	bool committed = false;
+};
+
+template <typename F> static inline rollback<F> make_rollback(F f) { return rollback<F>(std::move(f)); }
+
+#endif /* end of include guard: rollback_helper */
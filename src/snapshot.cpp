@@ -0,0 +1,320 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "poncri/snapshot.hpp"
+
+#include "context.hpp"
+#include "fileIO_helper.hpp"
+#include "ponci_internal.hpp"
+#include "ponri_internal.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// File format, all integers little endian:
+//   "PNCS" u32 version
+//   u32 #cgroups      { str name, list cpus, list mems, i8 cpu_exclusive, i8 mem_hardwall, i8 memory_migrate,
+//                       str freezer, u32 #hierarchies { str subsystem, tasks } }
+//   u32 #resgroups    { str name, u32 #resources { str resource, u32 #domains { u32 domain, u64 value } }, tasks }
+// with str = u32 length + bytes, list = u32 count + u32 values and tasks = u32 count + i32 tids.
+// Version 1 stored the cgroup tasks of the cpuset hierarchy only.
+static const char snapshot_magic[4] = {'P', 'N', 'C', 'S'};
+static const uint32_t snapshot_version = 2;
+
+struct snapshot {
+	layout groups;
+	// tasks of groups.cgroups[i] per subsystem hierarchy / of groups.resgroups[i]
+	std::vector<std::map<std::string, std::vector<pid_t>>> cgroup_tasks;
+	std::vector<std::vector<pid_t>> resgroup_tasks;
+};
+
+class snapshot_writer {
+  public:
+	void u8(uint8_t val) { _buf.push_back(static_cast<char>(val)); }
+	void u32(uint32_t val) {
+		for (int i = 0; i < 4; ++i) u8(static_cast<uint8_t>(val >> (8 * i)));
+	}
+	void u64(uint64_t val) {
+		for (int i = 0; i < 8; ++i) u8(static_cast<uint8_t>(val >> (8 * i)));
+	}
+	void str(const std::string &val) {
+		u32(static_cast<uint32_t>(val.size()));
+		_buf.append(val);
+	}
+	template <typename T> void list(const std::vector<T> &vals) {
+		u32(static_cast<uint32_t>(vals.size()));
+		for (const auto val : vals) u32(static_cast<uint32_t>(val));
+	}
+
+	const std::string &buffer() const { return _buf; }
+
+  private:
+	std::string _buf;
+};
+
+class snapshot_reader {
+  public:
+	explicit snapshot_reader(std::string buf) : _buf(std::move(buf)) {}
+
+	uint8_t u8() {
+		need(1);
+		return static_cast<uint8_t>(_buf[_pos++]);
+	}
+	uint32_t u32() {
+		need(4);
+		uint32_t res = 0;
+		for (int i = 0; i < 4; ++i) res |= static_cast<uint32_t>(u8()) << (8 * i);
+		return res;
+	}
+	uint64_t u64() {
+		need(8);
+		uint64_t res = 0;
+		for (int i = 0; i < 8; ++i) res |= static_cast<uint64_t>(u8()) << (8 * i);
+		return res;
+	}
+	std::string str() {
+		const auto len = u32();
+		need(len);
+		auto res = _buf.substr(_pos, len);
+		_pos += len;
+		return res;
+	}
+	template <typename T> std::vector<T> list() {
+		const auto size = u32();
+		// every element needs 4 bytes, do not trust the size for the allocation
+		need(static_cast<size_t>(size) * 4);
+		std::vector<T> res;
+		res.reserve(size);
+		for (uint32_t i = 0; i < size; ++i) res.push_back(static_cast<T>(u32()));
+		return res;
+	}
+
+	bool at_end() const { return _pos == _buf.size(); }
+
+  private:
+	void need(size_t bytes) const {
+		if (_buf.size() - _pos < bytes) throw std::runtime_error("Invalid snapshot file");
+	}
+
+	std::string _buf;
+	size_t _pos = 0;
+};
+
+/////////////////////////////////////////////////////////////////
+// PROTOTYPES
+/////////////////////////////////////////////////////////////////
+static snapshot read_snapshot(const std::string &filename);
+static std::vector<pid_t> cgroup_tasks(const std::string &name, const std::string &subsystem);
+static std::vector<pid_t> resgroup_tasks(const std::string &name);
+static std::vector<pid_t> missing_tasks(std::vector<pid_t> tasks, std::vector<pid_t> current);
+static void add_tasks(const std::string &filename, const std::vector<pid_t> &tids);
+
+/////////////////////////////////////////////////////////////////
+// EXPORTED FUNCTIONS
+/////////////////////////////////////////////////////////////////
+void ponci_snapshot(const std::string &filename, const std::string &cgroup_root) {
+	const auto groups = layout_capture(cgroup_root);
+
+	snapshot_writer out;
+	for (const auto c : snapshot_magic) out.u8(static_cast<uint8_t>(c));
+	out.u32(snapshot_version);
+
+	out.u32(static_cast<uint32_t>(groups.cgroups.size()));
+	for (const auto &group : groups.cgroups) {
+		out.str(group.name);
+		out.list(group.cpus);
+		out.list(group.mems);
+		out.u8(static_cast<uint8_t>(group.cpu_exclusive));
+		out.u8(static_cast<uint8_t>(group.mem_hardwall));
+		out.u8(static_cast<uint8_t>(group.memory_migrate));
+		out.str(group.freezer);
+		// on cgroup v1 a task may be in different groups of the cpuset and the freezer hierarchy
+		const auto &subsystems = current_context().subsystems();
+		out.u32(static_cast<uint32_t>(subsystems.size()));
+		for (const auto &sub : subsystems) {
+			out.str(sub);
+			out.list(cgroup_tasks(group.name, sub));
+		}
+	}
+
+	out.u32(static_cast<uint32_t>(groups.resgroups.size()));
+	for (const auto &group : groups.resgroups) {
+		out.str(group.name);
+		out.u32(static_cast<uint32_t>(group.schemata.size()));
+		for (const auto &resource : group.schemata) {
+			out.str(resource.first);
+			out.u32(static_cast<uint32_t>(resource.second.size()));
+			for (const auto &domain : resource.second) {
+				out.u32(domain.first);
+				out.u64(domain.second);
+			}
+		}
+		out.list(group.name.empty() ? std::vector<pid_t>() : resgroup_tasks(group.name));
+	}
+
+	const auto &buf = out.buffer();
+	throw_on_error(write_buffer_to_file_r(filename.c_str(), buf.data(), buf.size()));
+}
+
+std::vector<std::string> ponci_restore(const std::string &filename) {
+	const auto snap = read_snapshot(filename);
+
+	auto changes = ponci_apply(snap.groups);
+
+	// groups exist now, only tasks that are not yet in their group are written
+	for (size_t i = 0; i < snap.groups.cgroups.size(); ++i) {
+		const auto &name = snap.groups.cgroups[i].name;
+		const auto cgp = cgroup_path(name.c_str());
+		for (const auto &sub : current_context().subsystems()) {
+			// a hierarchy that was not mounted when the snapshot was taken is left alone
+			const auto saved = snap.cgroup_tasks[i].find(sub);
+			if (saved == snap.cgroup_tasks[i].end()) continue;
+
+			const auto tids = missing_tasks(saved->second, cgroup_tasks(name, sub));
+			if (tids.empty()) continue;
+
+			auto temp = cgp;
+			replace_subsystem_in_path(temp, sub);
+			add_tasks(temp + "tasks", tids);
+
+			const std::string hierarchy = sub.empty() ? std::string() : " (" + sub + ")";
+			changes.push_back("add " + std::to_string(tids.size()) + " tasks to cgroup " + name + hierarchy);
+		}
+	}
+
+	for (size_t i = 0; i < snap.groups.resgroups.size(); ++i) {
+		const auto &name = snap.groups.resgroups[i].name;
+		const auto tids = missing_tasks(snap.resgroup_tasks[i], resgroup_tasks(name));
+		if (tids.empty()) continue;
+
+		add_tasks(resgroup_path(name.c_str()) + "tasks", tids);
+		changes.push_back("add " + std::to_string(tids.size()) + " tasks to resgroup " + name);
+	}
+
+	return changes;
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+static snapshot read_snapshot(const std::string &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Could not open snapshot " + filename);
+	}
+	std::string buf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	snapshot_reader in(std::move(buf));
+
+	for (const auto c : snapshot_magic) {
+		if (in.u8() != static_cast<uint8_t>(c)) throw std::runtime_error("Invalid snapshot file");
+	}
+	if (in.u32() != snapshot_version) {
+		throw std::runtime_error("Unsupported snapshot version");
+	}
+
+	snapshot res;
+	const auto cgroups = in.u32();
+	for (uint32_t i = 0; i < cgroups; ++i) {
+		cgroup_layout group;
+		group.name = in.str();
+		group.cpus = in.list<size_t>();
+		group.mems = in.list<size_t>();
+		group.cpu_exclusive = static_cast<int8_t>(in.u8());
+		group.mem_hardwall = static_cast<int8_t>(in.u8());
+		group.memory_migrate = static_cast<int8_t>(in.u8());
+		group.freezer = in.str();
+		res.groups.cgroups.push_back(std::move(group));
+
+		std::map<std::string, std::vector<pid_t>> tasks;
+		const auto hierarchies = in.u32();
+		for (uint32_t h = 0; h < hierarchies; ++h) {
+			auto sub = in.str();
+			tasks[sub] = in.list<pid_t>();
+		}
+		res.cgroup_tasks.push_back(std::move(tasks));
+	}
+
+	const auto resgroups = in.u32();
+	for (uint32_t i = 0; i < resgroups; ++i) {
+		resgroup_layout group;
+		group.name = in.str();
+		const auto resources = in.u32();
+		for (uint32_t r = 0; r < resources; ++r) {
+			auto &domains = group.schemata[in.str()];
+			const auto count = in.u32();
+			for (uint32_t d = 0; d < count; ++d) {
+				const auto domain = in.u32();
+				domains[domain] = in.u64();
+			}
+		}
+		res.groups.resgroups.push_back(std::move(group));
+		res.resgroup_tasks.push_back(in.list<pid_t>());
+	}
+
+	if (!in.at_end()) throw std::runtime_error("Invalid snapshot file");
+	return res;
+}
+
+// tasks of the cgroup name in the hierarchy of subsystem
+static std::vector<pid_t> cgroup_tasks(const std::string &name, const std::string &subsystem) {
+	auto cgp = cgroup_path(name.c_str());
+	replace_subsystem_in_path(cgp, subsystem);
+	return read_lines_from_file<pid_t>(cgp + "tasks");
+}
+
+static std::vector<pid_t> resgroup_tasks(const std::string &name) {
+	return read_lines_from_file<pid_t>(resgroup_path(name.c_str()) + std::string("tasks"));
+}
+
+// returns the tasks that are not in current
+static std::vector<pid_t> missing_tasks(std::vector<pid_t> tasks, std::vector<pid_t> current) {
+	std::sort(tasks.begin(), tasks.end());
+	std::sort(current.begin(), current.end());
+
+	std::vector<pid_t> res;
+	std::set_difference(tasks.begin(), tasks.end(), current.begin(), current.end(), std::back_inserter(res));
+	return res;
+}
+
+// writes all tids through one file descriptor, tasks that exited are skipped
+static void add_tasks(const std::string &filename, const std::vector<pid_t> &tids) {
+	const int fd = open(filename.c_str(), O_WRONLY | O_CLOEXEC);
+	if (fd == -1) {
+		throw std::system_error(errno, std::generic_category());
+	}
+
+	for (const auto tid : tids) {
+		char buf[16];
+		const int len = snprintf(buf, sizeof(buf), "%d", tid);
+		if (write(fd, buf, static_cast<size_t>(len)) == -1 && errno != ESRCH) {
+			const int err = errno;
+			close(fd);
+			throw std::system_error(err, std::generic_category());
+		}
+	}
+
+	close(fd);
+}
@@ -0,0 +1,71 @@
+#ifndef topology_helper
+#define topology_helper
+
+#include "fileIO_helper.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+
+// returns the NUMA node of @p cpu, 0 on systems without NUMA information
+static inline size_t get_numa_node_of_cpu(size_t cpu) {
+	const std::string path("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/");
+	DIR *dir = opendir(path.c_str());
+	if (dir == nullptr) return 0;
+
+	size_t node = 0;
+	dirent *dent;
+	while ((dent = readdir(dir)) != nullptr) {
+		if (strncmp(dent->d_name, "node", 4) == 0) {
+			node = std::stoul(std::string(dent->d_name + 4));
+			break;
+		}
+	}
+	closedir(dir);
+
+	return node;
+}
+
+// returns the CPUs sharing the data or unified cache with the given @p level and @p id
+// the id is the domain id used by resctrl
+static inline std::vector<size_t> get_cpus_of_cache(unsigned int level, unsigned int id) {
+	std::vector<size_t> ret;
+
+	DIR *dir = opendir("/sys/devices/system/cpu/");
+	if (dir == nullptr) return ret;
+
+	dirent *dent;
+	while ((dent = readdir(dir)) != nullptr) {
+		if (strncmp(dent->d_name, "cpu", 3) != 0 || isdigit(dent->d_name[3]) == 0) continue;
+		const std::string cache = std::string("/sys/devices/system/cpu/") + dent->d_name + "/cache/";
+
+		for (size_t index = 0;; ++index) {
+			const std::string path = cache + "index" + std::to_string(index) + "/";
+			char buf[64];
+
+			if (read_file_to_buffer((path + "level").c_str(), buf, sizeof(buf), true) == 0) break;
+			if (strtoul(buf, nullptr, 10) != level) continue;
+
+			read_file_to_buffer((path + "type").c_str(), buf, sizeof(buf));
+			if (strncmp(buf, "Instruction", 11) == 0) continue;
+
+			read_file_to_buffer((path + "id").c_str(), buf, sizeof(buf), true);
+			if (buf[0] != '\0' && strtoul(buf, nullptr, 10) == id) {
+				ret.push_back(std::stoul(std::string(dent->d_name + 3)));
+			}
+			break;
+		}
+	}
+	closedir(dir);
+
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}
+
+#endif /* end of include guard: topology_helper */
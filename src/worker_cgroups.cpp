@@ -0,0 +1,85 @@
+/**
+ * po     n  c       i
+ * poor mans cgroups interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "ponci/ponci.hpp"
+
+#include "rollback_helper.hpp"
+#include "topology_helper.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void delete_groups(const std::vector<std::string> &names, const std::string &parent);
+
+worker_cgroups::worker_cgroups(const std::string &_parent, size_t workers)
+	: context(ponci_context_current()), parent(_parent), next(std::make_shared<std::atomic<size_t>>(0)) {
+	// pin_function distributes the threads round-robin over the workers
+	if (workers == 0) throw std::runtime_error("At least one worker cgroup is required in libponci.");
+	const auto parent_cpus = cgroup_get_cpus(parent);
+	if (parent_cpus.empty()) throw std::runtime_error("Parent cgroup has no CPUs in libponci.");
+	// the memory nodes of a child must be a subset of the nodes of its parent
+	const auto parent_mems = cgroup_get_mems(parent);
+	if (parent_mems.empty()) throw std::runtime_error("Parent cgroup has no memory nodes in libponci.");
+
+	auto undo = make_rollback([this] { delete_groups(names, parent); });
+	for (size_t i = 0; i < workers; ++i) {
+		const std::string name = parent + std::string("/worker") + std::to_string(i);
+		const size_t cpu = parent_cpus[i % parent_cpus.size()];
+
+		cgroup_create(name);
+		names.push_back(name);
+		cpus.push_back(cpu);
+
+		// the node of the CPU if the parent has it, all nodes of the parent otherwise
+		const size_t mem = get_numa_node_of_cpu(cpu);
+		cgroup_set_cpus(name, &cpu, 1);
+		if (std::find(parent_mems.begin(), parent_mems.end(), mem) != parent_mems.end()) {
+			cgroup_set_mems(name, &mem, 1);
+		} else {
+			cgroup_set_mems(name, parent_mems);
+		}
+	}
+	undo.commit();
+}
+
+worker_cgroups::~worker_cgroups() {
+	ponci_context_guard guard(context);
+	delete_groups(names, parent);
+}
+
+std::function<void()> worker_cgroups::pin_function() const {
+	const auto names_copy = names;
+	const auto counter = next;
+	const auto ctx = context;
+	return [names_copy, counter, ctx]() {
+		ponci_context_guard guard(ctx);
+		cgroup_add_me(names_copy[(*counter)++ % names_copy.size()]);
+	};
+}
+
+/////////////////////////////////////////////////////////////////
+// INTERNAL FUNCTIONS
+/////////////////////////////////////////////////////////////////
+
+// never throws, we clean up as much as possible. Also used if the constructor fails half way.
+static void delete_groups(const std::vector<std::string> &names, const std::string &parent) {
+	for (const auto &name : names) {
+		try {
+			for (const auto task : cgroup_get_tasks(name)) {
+				cgroup_add_task(parent, task);
+			}
+			cgroup_delete(name);
+		} catch (const std::runtime_error &) {
+		}
+	}
+}
@@ -0,0 +1,124 @@
+/**
+ * po     n  c       i
+ * poor mans cgroups interface
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "write_cache.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+constexpr size_t write_cache::num_shards;
+
+int write_cache::write(const std::vector<entry> &entries,
+						const std::function<int(const std::vector<entry> &)> &write) {
+	std::vector<std::string> keys;
+	std::vector<size_t> indices;
+	for (const auto &e : entries) {
+		keys.push_back(key(e));
+		indices.push_back(shard_index(keys.back()));
+	}
+
+	// shards are always locked in the order of their index
+	std::vector<size_t> order(indices);
+	std::sort(order.begin(), order.end());
+	order.erase(std::unique(order.begin(), order.end()), order.end());
+	std::vector<std::unique_lock<std::mutex>> locks;
+	for (const auto i : order) locks.emplace_back(shards[i].mutex);
+
+	std::vector<size_t> changed;
+	std::vector<entry> to_write;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const auto &cached = shards[indices[i]].entries;
+		const auto it = cached.find(keys[i]);
+		if (it != cached.end() && it->second.value == entries[i].value) continue;
+
+		changed.push_back(i);
+		to_write.push_back(entries[i]);
+	}
+	if (to_write.empty()) return 0;
+
+	const int err = write(to_write);
+	for (const auto i : changed) {
+		auto &cached = shards[indices[i]].entries;
+		if (err == 0) {
+			cached[keys[i]] = entries[i];
+		} else {
+			cached.erase(keys[i]);
+		}
+	}
+	return err;
+}
+
+void write_cache::erase(const entry &e) {
+	const auto k = key(e);
+	auto &s = shard_of(k);
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	s.entries.erase(k);
+}
+
+void write_cache::erase_group(const std::string &group, bool resgroup) {
+	for (auto &s : shards) {
+		std::lock_guard<std::mutex> lock(s.mutex);
+		for (auto it = s.entries.begin(); it != s.entries.end();) {
+			const bool is_schemata = it->second.attr == attribute::schemata;
+			if (it->second.group == group && is_schemata == resgroup) {
+				it = s.entries.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+
+void write_cache::clear() {
+	for (auto &s : shards) {
+		std::lock_guard<std::mutex> lock(s.mutex);
+		s.entries.clear();
+	}
+}
+
+std::vector<write_cache::entry> write_cache::entries() {
+	std::vector<entry> res;
+	for (auto &s : shards) {
+		std::lock_guard<std::mutex> lock(s.mutex);
+		for (const auto &e : s.entries) res.push_back(e.second);
+	}
+	return res;
+}
+
+std::string write_cache::list_value(const size_t *list, size_t size) {
+	std::vector<size_t> sorted(list, list + size);
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	std::string res;
+	for (const auto i : sorted) {
+		res.append(std::to_string(i));
+		res.append(",");
+	}
+	return res;
+}
+
+std::string write_cache::key(const entry &e) {
+	switch (e.attr) {
+	case attribute::cpus: return "cpus:" + e.group;
+	case attribute::mems: return "mems:" + e.group;
+	case attribute::schemata: return "schemata:" + e.group + ":" + e.resource + ":" + std::to_string(e.domain);
+	}
+	return std::string();
+}
+
+size_t write_cache::shard_index(const std::string &key) { return std::hash<std::string>()(key) % num_shards; }
+
+write_cache::shard &write_cache::shard_of(const std::string &key) { return shards[shard_index(key)]; }
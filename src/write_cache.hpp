@@ -0,0 +1,65 @@
+#ifndef ponci_write_cache
+#define ponci_write_cache
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+// Values last written through a context, used to skip writes that would not change anything.
+// Not part of the public interface.
+
+class write_cache {
+  public:
+	enum class attribute { cpus, mems, schemata };
+
+	struct entry {
+		attribute attr;
+		std::string group;
+		// resource and domain of a schemata entry, unused otherwise
+		std::string resource;
+		unsigned int domain;
+		// canonical value, see list_value / schemata_value
+		std::string value;
+	};
+
+	// calls write with the entries whose value is not the last value written to their attribute, unless there are
+	// none. write returns an errno code, on success the entries are stored, otherwise dropped. The shards of the
+	// entries stay locked until then, so concurrent writers of an attribute cannot leave a value in the cache the
+	// kernel does not have.
+	int write(const std::vector<entry> &entries, const std::function<int(const std::vector<entry> &)> &write);
+
+	void erase(const entry &e);
+
+	// drops the entries of group, the cpus / mems of a cgroup or the schemata of a ressource group
+	void erase_group(const std::string &group, bool resgroup);
+	void clear();
+
+	// returns a copy of all entries
+	std::vector<entry> entries();
+
+	// the order of cpus / memory nodes does not matter to the kernel
+	static std::string list_value(const size_t *list, size_t size);
+	static std::string schemata_value(uint64_t value) { return std::to_string(value); }
+
+  private:
+	// writers of different groups rarely share a shard
+	static constexpr size_t num_shards = 16;
+
+	struct shard {
+		std::mutex mutex;
+		std::unordered_map<std::string, entry> entries;
+	};
+
+	static std::string key(const entry &e);
+	static size_t shard_index(const std::string &key);
+	shard &shard_of(const std::string &key);
+
+	shard shards[num_shards];
+};
+
+#endif /* end of include guard: ponci_write_cache */
@@ -0,0 +1,143 @@
+/**
+ * po     n  c  r    i
+ * poor mans cgroups / resctrl interface
+ *
+ * Stress test of the thread-safety documented in ponci.h. 64 threads share one context with
+ * the write cache enabled, create, configure, join, leave and delete their own cgroup and
+ * read and refresh the resctrl info snapshot of a fake resctrl tree at the same time.
+ * Built with -fsanitize=thread, every error and every data race fails the test.
+ * The test is skipped (exit code 77) if cgroups cannot be created.
+ *
+ * Copyright 2016 by LRR-TUM
+ * Jens Breitbart     <j.breitbart@tum.de>
+ *
+ * Licensed under GNU Lesser General Public License 2.1 or later.
+ * Some rights reserved. See LICENSE
+ */
+
+#include "ponci/ponci.hpp"
+#include "ponri/ponri.hpp"
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const size_t num_threads = 64;
+static const size_t iterations = 20;
+static const int skip_return_code = 77;
+
+static std::atomic<size_t> failures(0);
+
+static void fail(const std::string &message) {
+	fprintf(stderr, "context_stress: %s\n", message.c_str());
+	++failures;
+}
+
+static void write_file(const std::string &filename, const std::string &content) {
+	std::ofstream file(filename);
+	file << content;
+}
+
+// a resctrl tree with a single L3 domain and 16 CLOSIDs
+static std::string create_fake_resctrl() {
+	char dir[] = "/tmp/ponci_stress_XXXXXX";
+	if (mkdtemp(dir) == nullptr) throw std::runtime_error(strerror(errno));
+
+	const std::string root = std::string(dir) + "/";
+	mkdir((root + "info").c_str(), S_IRWXU);
+	mkdir((root + "info/L3").c_str(), S_IRWXU);
+	write_file(root + "info/L3/cbm_mask", "ff\n");
+	write_file(root + "info/L3/min_cbm_bits", "1\n");
+	write_file(root + "info/L3/num_closids", "16\n");
+	write_file(root + "info/L3/shareable_bits", "0\n");
+	write_file(root + "schemata", "L3:0=ff\n");
+	return root;
+}
+
+static void remove_fake_resctrl(const std::string &root) {
+	for (const auto file : {"info/L3/cbm_mask", "info/L3/min_cbm_bits", "info/L3/num_closids",
+							"info/L3/shareable_bits", "schemata"}) {
+		unlink((root + file).c_str());
+	}
+	rmdir((root + "info/L3").c_str());
+	rmdir((root + "info").c_str());
+	rmdir(root.c_str());
+}
+
+static void worker(ponci_context *ctx, size_t id, const std::vector<size_t> &cpus, const std::vector<size_t> &mems) {
+	ponci_context_guard guard(ctx);
+	const std::string name = "ponci_stress_" + std::to_string(id);
+
+	for (size_t i = 0; i < iterations; ++i) {
+		try {
+			cgroup_create(name);
+			cgroup_set_cpus(name, cpus);
+			cgroup_set_mems(name, mems);
+			// the second write is skipped by the write cache
+			cgroup_set_mems(name, mems);
+			cgroup_add_me(name);
+			if (cgroup_get_tasks(name).empty()) fail(name + " has no tasks after cgroup_add_me");
+			cgroup_add_me("");
+			cgroup_delete(name);
+
+			const auto info = resctrl_get_info();
+			if (info->cache[RESCTRL_L3].cbm_mask != 0xff) fail("unexpected cbm_mask in the info snapshot");
+			if (i % 4 == id % 4) resctrl_refresh_info();
+		} catch (const std::exception &e) {
+			fail(name + ": " + e.what());
+			cgroup_add_me_r("");
+			cgroup_delete_r(name.c_str());
+		}
+	}
+}
+
+int main() {
+	// the default context discovers the cgroup hierarchy
+	const int err = cgroup_create_r("ponci_stress_probe");
+	if (err == EACCES || err == EPERM || err == EROFS || err == ENOENT || err == ENODEV) {
+		fprintf(stderr, "context_stress: cannot create cgroups (%s), skipped\n", strerror(err));
+		return skip_return_code;
+	}
+	if (err != 0 || cgroup_delete_r("ponci_stress_probe") != 0) {
+		fprintf(stderr, "context_stress: could not create the probe cgroup: %s\n", strerror(err));
+		return 1;
+	}
+
+	const auto resctrl = create_fake_resctrl();
+	auto ctx = ponci_context_create(nullptr, resctrl.c_str());
+	ponci_context_set_write_cache(ctx, 1);
+
+	int ret = 0;
+	try {
+		const auto cpus = cgroup_get_cpus("");
+		const auto mems = cgroup_get_mems("");
+
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < num_threads; ++i) threads.emplace_back(worker, ctx, i, cpus, mems);
+		for (auto &t : threads) t.join();
+
+		ponci_context_revalidate(ctx);
+	} catch (const std::exception &e) {
+		fail(e.what());
+	}
+
+	if (failures != 0) {
+		fprintf(stderr, "context_stress: %zu errors\n", failures.load());
+		ret = 1;
+	}
+
+	ponci_context_destroy(ctx);
+	remove_fake_resctrl(resctrl);
+	return ret;
+}